@@ -1,11 +1,16 @@
+#define _GNU_SOURCE // SO_BUSY_POLL, sched_setaffinity()
+#include <errno.h>
 #include <netdb.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <syslog.h>
 #include <arpa/inet.h>
+#include <netinet/in.h>
 #include "UDP_client.h"
 
 int UDP_fd=0;
@@ -89,6 +94,110 @@ int UDP_send(union CMD_DATA data){
 }
 
 
+int UDP_tuning_parse(struct UDP_tuning *t, const char *spec){
+    char buf[128];
+    char *save = NULL;
+
+    t->priority = -1;
+    t->dscp = -1;
+    t->busy_poll_us = 0;
+    t->sndbuf = 0;
+    t->cpu = -1;
+    if (spec == NULL) {
+        return(0);
+    }
+
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    for (char *tok = strtok_r(buf, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        int all = strcmp(tok, "all") == 0;
+        if (all || strcmp(tok, "prio") == 0) {
+            t->priority = UDP_LL_PRIORITY;
+        }
+        if (all || strcmp(tok, "dscp") == 0) {
+            t->dscp = UDP_LL_DSCP;
+        }
+        if (all || strcmp(tok, "busy") == 0) {
+            t->busy_poll_us = UDP_LL_BUSY_POLL_US;
+        }
+        if (all || strcmp(tok, "sndbuf") == 0) {
+            t->sndbuf = UDP_LL_SNDBUF;
+        }
+        if (strncmp(tok, "cpu=", 4) == 0) {
+            t->cpu = atoi(tok + 4);
+        } else if (!all && strcmp(tok, "prio") && strcmp(tok, "dscp") &&
+                   strcmp(tok, "busy") && strcmp(tok, "sndbuf")) {
+            fprintf(stderr, "Unknown socket tuning option '%s'\n", tok);
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+
+int UDP_apply_tuning(int fd, const struct UDP_tuning *t){
+    int failed = 0;
+    int s;
+
+    if (t->priority >= 0) {
+        s = setsockopt(fd, SOL_SOCKET, SO_PRIORITY, &t->priority, sizeof t->priority);
+        syslog(s < 0 ? LOG_WARNING : LOG_INFO, "UDP tuning: SO_PRIORITY %d %s%s", t->priority,
+               s < 0 ? "failed: " : "applied", s < 0 ? strerror(errno) : "");
+        failed += s < 0;
+    }
+
+    if (t->dscp >= 0) {
+        int domain = AF_INET;
+        socklen_t len = sizeof domain;
+        int tos = t->dscp << 2; // DSCP is the upper six bits of the TOS byte
+        getsockopt(fd, SOL_SOCKET, SO_DOMAIN, &domain, &len);
+        if (domain == AF_INET6) {
+            s = setsockopt(fd, IPPROTO_IPV6, IPV6_TCLASS, &tos, sizeof tos);
+        } else {
+            s = setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof tos);
+        }
+        syslog(s < 0 ? LOG_WARNING : LOG_INFO, "UDP tuning: DSCP %d %s%s", t->dscp,
+               s < 0 ? "failed: " : "applied", s < 0 ? strerror(errno) : "");
+        failed += s < 0;
+    }
+
+    if (t->busy_poll_us > 0) {
+        s = setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &t->busy_poll_us, sizeof t->busy_poll_us);
+        syslog(s < 0 ? LOG_WARNING : LOG_INFO, "UDP tuning: SO_BUSY_POLL %d us %s%s", t->busy_poll_us,
+               s < 0 ? "failed: " : "applied", s < 0 ? strerror(errno) : "");
+        failed += s < 0;
+    }
+
+    if (t->sndbuf > 0) {
+        int actual = 0;
+        socklen_t len = sizeof actual;
+        s = setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &t->sndbuf, sizeof t->sndbuf);
+        getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &actual, &len); // kernel doubles the request
+        syslog(s < 0 ? LOG_WARNING : LOG_INFO, "UDP tuning: SO_SNDBUF %d (kernel %d) %s%s", t->sndbuf,
+               actual, s < 0 ? "failed: " : "applied", s < 0 ? strerror(errno) : "");
+        failed += s < 0;
+    }
+
+    return(failed);
+}
+
+
+int UDP_pin_thread(const struct UDP_tuning *t){
+    cpu_set_t set;
+
+    if (t->cpu < 0) {
+        return(0);
+    }
+    CPU_ZERO(&set);
+    CPU_SET(t->cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        syslog(LOG_WARNING, "UDP tuning: pinning sender to CPU %d failed: %s", t->cpu, strerror(errno));
+        return(-1);
+    }
+    syslog(LOG_INFO, "UDP tuning: sender pinned to CPU %d", t->cpu);
+    return(0);
+}
+
 
 #ifdef UDP_TESTING
 int main(int argc, char *argv[])
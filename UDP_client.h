@@ -1,3 +1,6 @@
+#ifndef INC_UDP_CLIENT_H_
+#define INC_UDP_CLIENT_H_
+
 #include <netdb.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,6 +13,12 @@
 #define BUF_SIZE 500
 #define CMD_SIZE 52 // 52 bytes for 26 int16_t values
 
+// Low-latency profile values
+#define UDP_LL_PRIORITY 6      // highest SO_PRIORITY without CAP_NET_ADMIN
+#define UDP_LL_DSCP 46         // Expedited Forwarding
+#define UDP_LL_BUSY_POLL_US 50
+#define UDP_LL_SNDBUF 16384    // a few batches; deeper queues only add delay
+
 union CMD_DATA {
     unsigned char bytes[CMD_SIZE];
     int16_t values[CMD_SIZE/2];
@@ -25,3 +34,39 @@ union CMD_DATA {
 int UDP_init(char *ip, char *port);
 
 int UDP_send(union CMD_DATA data);
+
+/**
+ * @brief: optional socket tuning; negative/zero fields are left untouched
+ */
+struct UDP_tuning {
+    int priority;     // SO_PRIORITY, -1 to leave
+    int dscp;         // DSCP for IP_TOS/IPV6_TCLASS, -1 to leave
+    int busy_poll_us; // SO_BUSY_POLL on the ack receive path, 0 to leave
+    int sndbuf;       // SO_SNDBUF bytes, 0 to leave
+    int cpu;          // CPU to pin the sending thread to, -1 to leave
+};
+
+/**
+ * @brief: fills a tuning from a spec: "all" for the whole low-latency profile,
+ * or a comma list of prio, dscp, busy, sndbuf, cpu=N
+ * @param: t tuning to fill
+ * @param: spec profile spec, NULL for no tuning
+ * @return: 0 on success, -1 on an unknown option
+ */
+int UDP_tuning_parse(struct UDP_tuning *t, const char *spec);
+
+/**
+ * @brief: applies the socket options of a tuning and reports them via syslog
+ * @param: fd socket
+ * @param: t tuning
+ * @return: number of options that could not be applied
+ */
+int UDP_apply_tuning(int fd, const struct UDP_tuning *t);
+
+/**
+ * @brief: pins the calling thread to t->cpu, if set
+ * @return: 0 on success or nothing to do, -1 on failure
+ */
+int UDP_pin_thread(const struct UDP_tuning *t);
+
+#endif /* INC_UDP_CLIENT_H_ */
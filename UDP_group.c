@@ -0,0 +1,283 @@
+#define _GNU_SOURCE // sendmmsg()
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include "UDP_group.h"
+
+// sendmmsg() flushes one socket, so targets share one unconnected socket per
+// address family and every frame goes out to all boards in a single call.
+static int fd_v4 = -1;
+static int fd_v6 = -1;
+static int multicast_ttl = 1;
+
+static int num_targets = 0;
+static struct sockaddr_storage target_addr[UDP_GROUP_MAX_TARGETS];
+static socklen_t target_addrlen[UDP_GROUP_MAX_TARGETS];
+static struct UDP_target_stats target_stats[UDP_GROUP_MAX_TARGETS];
+
+
+int UDP_group_init(int ttl){
+    UDP_group_close();
+    multicast_ttl = ttl > 0 ? ttl : 1;
+    return(0);
+}
+
+/**
+ * @brief: returns the shared socket for a family, creating it on first use
+ */
+static int family_socket(int family){
+    int *fdp = (family == AF_INET6) ? &fd_v6 : &fd_v4;
+    if (*fdp >= 0) {
+        return(*fdp);
+    }
+
+    int sfd = socket(family, SOCK_DGRAM, 0);
+    if (sfd == -1) {
+        fprintf(stderr, "socket: %s\n", strerror(errno));
+        return(-1);
+    }
+
+    // same timeouts as UDP_init() so a stuck board never blocks the sampler
+    struct timeval timeout;
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    if (setsockopt(sfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout) < 0 ||
+        setsockopt(sfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout) < 0) {
+        fprintf(stderr, "Failed to set socket options: %s\n", strerror(errno));
+        close(sfd);
+        return(-1);
+    }
+
+    // multicast options are harmless when only unicast targets are used
+    unsigned char loop = 1; // let a mock receiver on this host see the group
+    int s;
+    if (family == AF_INET6) {
+        int hops = multicast_ttl;
+        unsigned int loop6 = loop;
+        s = setsockopt(sfd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &hops, sizeof hops);
+        if (s == 0) {
+            s = setsockopt(sfd, IPPROTO_IPV6, IPV6_MULTICAST_LOOP, &loop6, sizeof loop6);
+        }
+    } else {
+        unsigned char ttl = (unsigned char)multicast_ttl;
+        s = setsockopt(sfd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof ttl);
+        if (s == 0) {
+            s = setsockopt(sfd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof loop);
+        }
+    }
+    if (s < 0) {
+        fprintf(stderr, "Failed to set multicast options: %s\n", strerror(errno));
+        close(sfd);
+        return(-1);
+    }
+
+    *fdp = sfd;
+    return(sfd);
+}
+
+static int is_multicast(const struct sockaddr *sa){
+    if (sa->sa_family == AF_INET6) {
+        return(IN6_IS_ADDR_MULTICAST(&((const struct sockaddr_in6 *)sa)->sin6_addr));
+    }
+    return(IN_MULTICAST(ntohl(((const struct sockaddr_in *)sa)->sin_addr.s_addr)));
+}
+
+
+int UDP_group_add_target(char *ip, char *port){
+    struct addrinfo hints;
+    struct addrinfo *result;
+    int s;
+
+    if (num_targets >= UDP_GROUP_MAX_TARGETS) {
+        fprintf(stderr, "Too many UDP targets (max %d)\n", UDP_GROUP_MAX_TARGETS);
+        return(-1);
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;    // Allow IPv4 or IPv6
+    hints.ai_socktype = SOCK_DGRAM; // Datagram socket
+
+    s = getaddrinfo(ip, port, &hints, &result);
+    if (s != 0) {
+        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(s));
+        return(-1);
+    }
+
+    // first address is used; each board is expected to resolve uniquely
+    if (family_socket(result->ai_family) < 0) {
+        freeaddrinfo(result);
+        return(-1);
+    }
+
+    int t = num_targets;
+    memcpy(&target_addr[t], result->ai_addr, result->ai_addrlen);
+    target_addrlen[t] = result->ai_addrlen;
+    memset(&target_stats[t], 0, sizeof(target_stats[t]));
+    snprintf(target_stats[t].name, sizeof(target_stats[t].name), "%s:%s", ip, port);
+    target_stats[t].multicast = is_multicast(result->ai_addr);
+    freeaddrinfo(result);
+
+    num_targets++;
+    syslog(LOG_INFO, "UDP target %d: %s%s", t, target_stats[t].name,
+           target_stats[t].multicast ? " (multicast)" : "");
+    return(t);
+}
+
+
+int UDP_group_add_spec(char *spec){
+    char host[64];
+    char *colon = strrchr(spec, ':');
+
+    if (colon == NULL || colon == spec || colon[1] == '\0') {
+        fprintf(stderr, "Bad UDP target '%s', expected host:port\n", spec);
+        return(-1);
+    }
+
+    size_t len = colon - spec;
+    if (spec[0] == '[' && colon[-1] == ']') { // [v6addr]:port
+        spec++;
+        len -= 2;
+    }
+    if (len >= sizeof(host)) {
+        fprintf(stderr, "UDP target host too long: %s\n", spec);
+        return(-1);
+    }
+    memcpy(host, spec, len);
+    host[len] = '\0';
+
+    return(UDP_group_add_target(host, colon + 1));
+}
+
+
+/**
+ * @brief: sends one batch of messages on a family socket and charges the
+ * result to each message's target.  A failing message is skipped and the
+ * rest of the batch is retried so one dead board cannot starve the others.
+ */
+static int flush_family(int fd, struct mmsghdr *msgs, const int *owner, unsigned int count){
+    unsigned int done = 0;
+    int sent_total = 0;
+
+    while (done < count) {
+        int r = sendmmsg(fd, msgs + done, count - done, 0);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            struct UDP_target_stats *st = &target_stats[owner[done]];
+            st->frames_failed++;
+            st->last_errno = errno;
+            done++;
+            continue;
+        }
+        for (int i = 0; i < r; i++) {
+            struct UDP_target_stats *st = &target_stats[owner[done + i]];
+            st->frames_sent++;
+            st->bytes_sent += msgs[done + i].msg_len;
+        }
+        sent_total += r;
+        done += r;
+    }
+    return(sent_total);
+}
+
+
+int UDP_group_send_raw(const unsigned char *frames, size_t frame_len, unsigned int n){
+    // one message per (frame, target); targets of a family are interleaved so
+    // frame k reaches every board before frame k+1 goes out to any of them
+    static struct mmsghdr msgs[UDP_GROUP_MAX_BATCH * UDP_GROUP_MAX_TARGETS];
+    static struct iovec iov[UDP_GROUP_MAX_BATCH * UDP_GROUP_MAX_TARGETS];
+    static int owner[UDP_GROUP_MAX_BATCH * UDP_GROUP_MAX_TARGETS];
+    int sent = 0;
+
+    if (num_targets == 0 || n == 0 || n > UDP_GROUP_MAX_BATCH) {
+        return(-1);
+    }
+
+    int families[2] = {AF_INET, AF_INET6};
+    for (int f = 0; f < 2; f++) {
+        int fd = (families[f] == AF_INET) ? fd_v4 : fd_v6;
+        unsigned int count = 0;
+        if (fd < 0) {
+            continue;
+        }
+        for (unsigned int k = 0; k < n; k++) {
+            for (int t = 0; t < num_targets; t++) {
+                if (target_addr[t].ss_family != families[f]) {
+                    continue;
+                }
+                iov[count].iov_base = (void *)(frames + k * frame_len);
+                iov[count].iov_len = frame_len;
+                memset(&msgs[count].msg_hdr, 0, sizeof(msgs[count].msg_hdr));
+                msgs[count].msg_hdr.msg_name = &target_addr[t];
+                msgs[count].msg_hdr.msg_namelen = target_addrlen[t];
+                msgs[count].msg_hdr.msg_iov = &iov[count];
+                msgs[count].msg_hdr.msg_iovlen = 1;
+                owner[count] = t;
+                count++;
+            }
+        }
+        sent += flush_family(fd, msgs, owner, count);
+    }
+    return(sent);
+}
+
+
+int UDP_group_send(union CMD_DATA data){
+    if (num_targets == 0) {
+        return(-1);
+    }
+    int sent = UDP_group_send_raw(data.bytes, CMD_SIZE, 1);
+    if (sent != num_targets) {
+        fprintf(stderr, "frame reached %d of %d targets\n", sent, num_targets);
+    }
+    return(sent);
+}
+
+
+int UDP_group_fd(int family){
+    return(family == AF_INET6 ? fd_v6 : fd_v4);
+}
+
+int UDP_group_num_targets(void){
+    return(num_targets);
+}
+
+const struct UDP_target_stats *UDP_group_stats(int target){
+    if (target < 0 || target >= num_targets) {
+        return(NULL);
+    }
+    return(&target_stats[target]);
+}
+
+
+void UDP_group_report(void){
+    for (int t = 0; t < num_targets; t++) {
+        struct UDP_target_stats *st = &target_stats[t];
+        syslog(LOG_INFO, "UDP target %s: %lu frames (%lu bytes) sent, %lu failed%s%s",
+               st->name, st->frames_sent, st->bytes_sent, st->frames_failed,
+               st->last_errno ? ", last error: " : "",
+               st->last_errno ? strerror(st->last_errno) : "");
+    }
+}
+
+
+void UDP_group_close(void){
+    if (fd_v4 >= 0) {
+        close(fd_v4);
+    }
+    if (fd_v6 >= 0) {
+        close(fd_v6);
+    }
+    fd_v4 = -1;
+    fd_v6 = -1;
+    num_targets = 0;
+}
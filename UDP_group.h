@@ -0,0 +1,83 @@
+/**
+ * @file UDP_group.h
+ * @brief Command distribution to several KASM boards: a list of unicast
+ * targets and/or multicast groups, flushed together with sendmmsg().
+ */
+
+#ifndef INC_UDP_GROUP_H_
+#define INC_UDP_GROUP_H_
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include "UDP_client.h"
+
+#define UDP_GROUP_MAX_TARGETS 32
+#define UDP_GROUP_MAX_BATCH 64 // frames per UDP_group_send_raw() flush
+
+struct UDP_target_stats {
+    char name[64];               // target as given, e.g. "10.0.0.7:2345"
+    int multicast;               // 1 if the target is a multicast group
+    unsigned long frames_sent;
+    unsigned long frames_failed;
+    unsigned long bytes_sent;
+    int last_errno;              // errno of the most recent failure, 0 if none
+};
+
+/**
+ * @brief: initializes the distribution layer
+ * @param: ttl multicast TTL/hop limit (1 keeps groups on the local subnet)
+ * @return: 0 on success, -1 on failure
+ */
+int UDP_group_init(int ttl);
+
+/**
+ * @brief: adds a unicast or multicast target
+ * @param: ip host name or address
+ * @param: port
+ * @return: target index on success, -1 on failure
+ */
+int UDP_group_add_target(char *ip, char *port);
+
+/**
+ * @brief: adds a target given as "host:port" or "[v6addr]:port"
+ * @param: spec target string
+ * @return: target index on success, -1 on failure
+ */
+int UDP_group_add_spec(char *spec);
+
+/**
+ * @brief: sends one command frame to every target
+ * @param: data command frame, already in network byte order
+ * @return: number of targets the frame reached, -1 if none were configured
+ */
+int UDP_group_send(union CMD_DATA data);
+
+/**
+ * @brief: sends n frames to every target in as few sendmmsg() calls as possible
+ * @param: frames n contiguous frames of frame_len bytes each
+ * @param: frame_len bytes per frame
+ * @param: n number of frames, at most UDP_GROUP_MAX_BATCH
+ * @return: number of datagrams sent, -1 on invalid arguments
+ */
+int UDP_group_send_raw(const unsigned char *frames, size_t frame_len, unsigned int n);
+
+/**
+ * @brief: socket descriptor for targets of the given address family, for
+ * callers that read replies (acks, echoes) from the targets
+ * @param: family AF_INET or AF_INET6
+ * @return: descriptor, or -1 if no target of that family exists
+ */
+int UDP_group_fd(int family);
+
+int UDP_group_num_targets(void);
+
+const struct UDP_target_stats *UDP_group_stats(int target);
+
+/**
+ * @brief: logs per-target statistics to syslog
+ */
+void UDP_group_report(void);
+
+void UDP_group_close(void);
+
+#endif /* INC_UDP_GROUP_H_ */
@@ -0,0 +1,165 @@
+#include <math.h>
+#include <string.h>
+#include "autotune.h"
+
+static const char *rule_names[] = {"zn", "pi", "pessen", "some", "none", "tl"};
+
+void autotune_init(struct autotune *at, int16_t center, int16_t amplitude, double t){
+    memset(at, 0, sizeof(*at));
+    at->center = center;
+    at->amplitude = amplitude;
+    at->state = AUTOTUNE_SETPOINT;
+    at->t_phase = t;
+    step_stats_init(&at->base, 0, center);
+    step_stats_init(&at->probe, 1, center + amplitude);
+}
+
+static int16_t relay_command(const struct autotune *at){
+    return at->center + at->sign * at->relay * at->amplitude;
+}
+
+int16_t autotune_sample(struct autotune *at, double t, uint32_t code){
+    double y = code;
+
+    switch (at->state) {
+        case AUTOTUNE_SETPOINT:
+            step_stats_add(&at->base, t, code);
+            if (t - at->t_phase < AUTOTUNE_SETTLE_S) {
+                return at->center;
+            }
+            at->setpoint = at->base.mean_y;
+            at->hyst = AUTOTUNE_HYST_SIGMA * step_stats_noise_rms(&at->base);
+            if (at->hyst < 1) {
+                at->hyst = 1;
+            }
+            at->state = AUTOTUNE_PROBE;
+            at->t_phase = t;
+            return at->center + at->amplitude;
+
+        case AUTOTUNE_PROBE:
+            // only the second half, after the actuator has moved
+            if (t - at->t_phase > AUTOTUNE_PROBE_S / 2) {
+                step_stats_add(&at->probe, t, code);
+            }
+            if (t - at->t_phase < AUTOTUNE_PROBE_S) {
+                return at->center + at->amplitude;
+            }
+            at->probe_delta = at->probe.mean_y - at->setpoint;
+            if (fabs(at->probe_delta) < 2 * at->hyst) {
+                at->state = AUTOTUNE_FAILED; // the rig does not respond above the noise
+                return at->center;
+            }
+            at->sign = at->probe_delta > 0 ? 1 : -1;
+            at->relay = -1; // head back through the setpoint
+            at->state = AUTOTUNE_RELAY;
+            at->t_phase = t;
+            at->cross_t = -1;
+            return relay_command(at);
+
+        case AUTOTUNE_RELAY:
+            if (t - at->t_phase > AUTOTUNE_TIMEOUT_S) {
+                at->state = AUTOTUNE_FAILED;
+                return at->center;
+            }
+            if (y > at->y_max) {
+                at->y_max = y;
+            }
+            if (y < at->y_min) {
+                at->y_min = y;
+            }
+            // relay +1 pushes the code up whatever the rig's direction
+            double e = at->setpoint - y;
+            if (e > at->hyst && at->relay < 0) {
+                at->relay = 1;
+                if (at->cross_t >= 0) {
+                    if (at->cycles > 0) {
+                        at->period_sum += t - at->cross_t;
+                        at->amp_sum += (at->y_max - at->y_min) / 2;
+                    }
+                    at->cycles++;
+                }
+                at->cross_t = t;
+                at->y_max = at->y_min = y;
+                if (at->cycles > AUTOTUNE_CYCLES) {
+                    // first cycle is discarded as the transient
+                    double a = at->amp_sum / AUTOTUNE_CYCLES;
+                    // a relay with hysteresis h sees an effective amplitude sqrt(a^2 - h^2)
+                    double a_eff = a > at->hyst ? sqrt(a * a - at->hyst * at->hyst) : a;
+                    at->tu = at->period_sum / AUTOTUNE_CYCLES;
+                    at->ku = 4.0 * at->amplitude / (M_PI * a_eff);
+                    at->state = AUTOTUNE_DONE;
+                    return at->center;
+                }
+            } else if (e < -at->hyst && at->relay > 0) {
+                at->relay = -1;
+            }
+            return relay_command(at);
+
+        default:
+            return at->center;
+    }
+}
+
+void autotune_gains(const struct autotune *at, enum pid_rule rule, struct pid_gains *g){
+    // Kp, Ti and Td as fractions of Ku and Tu
+    static const double table[][3] = {
+        [PID_RULE_ZN]             = {0.60, 0.50, 0.125},
+        [PID_RULE_PI]             = {0.45, 1 / 1.2, 0},
+        [PID_RULE_PESSEN]         = {0.70, 0.40, 0.15},
+        [PID_RULE_SOME_OVERSHOOT] = {0.33, 0.50, 1 / 3.0},
+        [PID_RULE_NO_OVERSHOOT]   = {0.20, 0.50, 1 / 3.0},
+        [PID_RULE_TYREUS_LUYBEN]  = {0.45, 2.2, 1 / 6.3},
+    };
+    double kp = table[rule][0] * at->ku;
+    double ti = table[rule][1] * at->tu;
+    g->kp = at->sign * kp;
+    g->ki = ti > 0 ? g->kp / ti : 0;
+    g->kd = g->kp * table[rule][2] * at->tu;
+}
+
+int pid_rule_parse(const char *name, enum pid_rule *rule){
+    for (int i = 0; i < (int)(sizeof(rule_names) / sizeof(rule_names[0])); i++) {
+        if (strcmp(name, rule_names[i]) == 0) {
+            *rule = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *pid_rule_name(enum pid_rule rule){
+    return rule_names[rule];
+}
+
+void step_check_init(struct step_check *sc, double from, double to, double t0){
+    memset(sc, 0, sizeof(*sc));
+    sc->from = from;
+    sc->to = to;
+    sc->t0 = t0;
+    sc->peak = from;
+    sc->last_out = t0;
+}
+
+void step_check_sample(struct step_check *sc, double t, double y){
+    double dir = sc->to >= sc->from ? 1 : -1;
+    if (dir * (y - sc->peak) > 0) {
+        sc->peak = y;
+    }
+    if (fabs(y - sc->to) > AUTOTUNE_SETTLE_BAND * fabs(sc->to - sc->from)) {
+        sc->last_out = t;
+    }
+    sc->n++;
+}
+
+int step_check_result(const struct step_check *sc, double t_end, double *overshoot, double *settle_s){
+    double step = fabs(sc->to - sc->from);
+    double dir = sc->to >= sc->from ? 1 : -1;
+    *overshoot = step > 0 ? dir * (sc->peak - sc->to) / step : 0;
+    if (*overshoot < 0) {
+        *overshoot = 0;
+    }
+    // settled if the last fifth of the test stayed inside the band
+    int settled = sc->n > 0 && sc->last_out < t_end - 0.2 * (t_end - sc->t0);
+    *settle_s = settled ? sc->last_out - sc->t0 : -1;
+    return settled && *overshoot <= AUTOTUNE_MAX_OVERSHOOT;
+}
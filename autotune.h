@@ -0,0 +1,116 @@
+/**
+ * @file autotune.h
+ * @brief Relay-feedback (Astrom-Hagglund) auto-tuning. The actuator command
+ * is switched between center +/- amplitude whenever the LHR code crosses the
+ * setpoint, which drives the loop into a limit cycle at its ultimate period.
+ * The ultimate gain follows from the relay amplitude and the oscillation
+ * amplitude, and PID gains from a tuning rule. A closed-loop step test then
+ * checks the gains before they are kept.
+ * @note Sample-driven and hardware independent: the caller feeds (t, code)
+ * pairs and sends the returned command.
+ */
+
+#ifndef INC_AUTOTUNE_H_
+#define INC_AUTOTUNE_H_
+
+#include <stdint.h>
+#include "pid.h"
+#include "step_stats.h"
+
+#define AUTOTUNE_SETTLE_S 0.2     // setpoint measurement at the center command
+#define AUTOTUNE_PROBE_S 0.2      // open-loop step that finds the rig's direction
+#define AUTOTUNE_CYCLES 4         // limit cycles averaged, after one discarded
+#define AUTOTUNE_TIMEOUT_S 30.0   // relay phase gives up after this
+#define AUTOTUNE_HYST_SIGMA 3.0   // relay hysteresis in noise rms
+#define AUTOTUNE_MAX_OVERSHOOT 0.5  // step test fails above this fraction
+#define AUTOTUNE_SETTLE_BAND 0.05   // step test: settled within this fraction
+
+enum autotune_state {
+    AUTOTUNE_SETPOINT = 0,
+    AUTOTUNE_PROBE,
+    AUTOTUNE_RELAY,
+    AUTOTUNE_DONE,
+    AUTOTUNE_FAILED
+};
+
+enum pid_rule {
+    PID_RULE_ZN = 0,        // Ziegler-Nichols classic
+    PID_RULE_PI,            // Ziegler-Nichols PI
+    PID_RULE_PESSEN,        // Pessen integral rule
+    PID_RULE_SOME_OVERSHOOT,
+    PID_RULE_NO_OVERSHOOT,
+    PID_RULE_TYREUS_LUYBEN
+};
+
+struct autotune {
+    int16_t center;         // command the relay switches around
+    int16_t amplitude;      // relay amplitude, command units
+    enum autotune_state state;
+    double t_phase;         // start of the current phase, s
+    struct step_stats base; // codes at the center command
+    struct step_stats probe;
+    double setpoint;        // codes
+    double hyst;            // codes
+    double probe_delta;     // code change for +amplitude
+    int sign;               // +1 if the code rises with the command
+    int relay;              // current relay output, +1 or -1
+    int cycles;             // completed limit cycles
+    double cross_t;         // last rising crossing, s
+    double y_max, y_min;    // extremes of the current cycle
+    double period_sum;
+    double amp_sum;
+    double ku;              // ultimate gain, command units per code
+    double tu;              // ultimate period, s
+};
+
+/**
+ * @brief Start a tuning run
+ * @param center command the rig is held at
+ * @param amplitude relay amplitude in command units
+ * @param t current time, s
+ */
+void autotune_init(struct autotune *at, int16_t center, int16_t amplitude, double t);
+
+/**
+ * @brief Feed one sample
+ * @return command to apply next
+ */
+int16_t autotune_sample(struct autotune *at, double t, uint32_t code);
+
+/**
+ * @brief PID gains for the identified ku/tu, signed for the rig's direction
+ */
+void autotune_gains(const struct autotune *at, enum pid_rule rule, struct pid_gains *g);
+
+/**
+ * @brief Parse zn, pi, pessen, some, none or tl
+ * @return 0 on success, -1 on an unknown name
+ */
+int pid_rule_parse(const char *name, enum pid_rule *rule);
+
+const char *pid_rule_name(enum pid_rule rule);
+
+// Closed-loop step response check
+struct step_check {
+    double from;            // codes before the step
+    double to;              // setpoint after the step
+    double t0;
+    double peak;            // furthest excursion in the step direction
+    double last_out;        // last time outside the settling band
+    unsigned long n;
+};
+
+void step_check_init(struct step_check *sc, double from, double to, double t0);
+
+void step_check_sample(struct step_check *sc, double t, double y);
+
+/**
+ * @brief Evaluate the response
+ * @param overshoot fraction of the step beyond the setpoint
+ * @param settle_s time to stay within the band, negative if it never settled
+ * @param t_end end of the test, s
+ * @return 1 if the response is acceptable, 0 otherwise
+ */
+int step_check_result(const struct step_check *sc, double t_end, double *overshoot, double *settle_s);
+
+#endif /* INC_AUTOTUNE_H_ */
@@ -0,0 +1,136 @@
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include "batch_pool.h"
+
+#define NIL UINT32_MAX
+
+static unsigned char *base = NULL;
+static size_t stride;
+static unsigned capacity;
+
+// Treiber stack of batch indices; the head carries a tag in its upper half
+// that changes on every pop, so a stale compare-and-swap cannot succeed (ABA)
+static _Atomic uint64_t head;
+static _Atomic uint32_t *next;
+static atomic_uint free_count;
+static atomic_uint free_min;
+static atomic_ulong refills;
+static atomic_ulong spills;
+static atomic_ulong exhausted;
+
+static _Thread_local struct {
+    unsigned n;
+    uint32_t idx[BATCH_POOL_CACHE];
+} cache;
+
+static void push(uint32_t i){
+    uint64_t old = atomic_load(&head);
+    do {
+        atomic_store_explicit(&next[i], (uint32_t)old, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak(&head, &old, (old & 0xFFFFFFFF00000000ull) | i));
+    atomic_fetch_add_explicit(&free_count, 1, memory_order_relaxed);
+}
+
+static uint32_t pop(void){
+    uint64_t old = atomic_load(&head);
+    uint64_t new;
+    do {
+        uint32_t i = (uint32_t)old;
+        if (i == NIL) {
+            return NIL;
+        }
+        new = ((old >> 32) + 1) << 32 | atomic_load_explicit(&next[i], memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak(&head, &old, new));
+
+    unsigned left = atomic_fetch_sub_explicit(&free_count, 1, memory_order_relaxed) - 1;
+    unsigned low = atomic_load_explicit(&free_min, memory_order_relaxed);
+    while (left < low && !atomic_compare_exchange_weak_explicit(&free_min, &low, left,
+                                                                memory_order_relaxed, memory_order_relaxed)) {
+    }
+    return (uint32_t)old;
+}
+
+unsigned batch_pool_count_for(double samples_per_s, unsigned per_batch, double buffer_s, int threads){
+    double in_flight = ceil(samples_per_s * buffer_s / per_batch);
+    // a batch being filled, and what the thread caches can hold back
+    return (unsigned)in_flight + 2 + (unsigned)threads * BATCH_POOL_CACHE;
+}
+
+int batch_pool_init(size_t batch_size, unsigned count){
+    if (count < 2 * BATCH_POOL_CACHE + 2) {
+        count = 2 * BATCH_POOL_CACHE + 2; // else two full caches could starve each other
+    }
+    stride = (batch_size + BATCH_POOL_ALIGN - 1) / BATCH_POOL_ALIGN * BATCH_POOL_ALIGN;
+    base = aligned_alloc(BATCH_POOL_ALIGN, stride * count);
+    next = calloc(count, sizeof(*next));
+    if (base == NULL || next == NULL) {
+        syslog(LOG_ERR, "Failed to allocate %u sample batches of %zu bytes", count, stride);
+        batch_pool_free();
+        return -1;
+    }
+    memset(base, 0, stride * count); // fault every page in now, not on the sample path
+    capacity = count;
+    atomic_store(&head, NIL);
+    atomic_store(&free_count, 0);
+    for (uint32_t i = count; i-- > 0; ) {
+        push(i);
+    }
+    atomic_store(&free_min, count);
+    atomic_store(&refills, 0);
+    atomic_store(&spills, 0);
+    atomic_store(&exhausted, 0);
+    cache.n = 0;
+    return 0;
+}
+
+void *batch_pool_get(void){
+    if (cache.n == 0) {
+        uint32_t i;
+        while (cache.n < BATCH_POOL_CACHE / 2 && (i = pop()) != NIL) {
+            cache.idx[cache.n++] = i;
+        }
+        if (cache.n == 0) {
+            atomic_fetch_add_explicit(&exhausted, 1, memory_order_relaxed);
+            return NULL;
+        }
+        atomic_fetch_add_explicit(&refills, 1, memory_order_relaxed);
+    }
+    return base + cache.idx[--cache.n] * stride;
+}
+
+void batch_pool_put(void *batch){
+    if (cache.n == BATCH_POOL_CACHE) {
+        while (cache.n > BATCH_POOL_CACHE / 2) {
+            push(cache.idx[--cache.n]);
+        }
+        atomic_fetch_add_explicit(&spills, 1, memory_order_relaxed);
+    }
+    cache.idx[cache.n++] = (uint32_t)(((unsigned char *)batch - base) / stride);
+}
+
+void batch_pool_thread_exit(void){
+    while (cache.n > 0) {
+        push(cache.idx[--cache.n]);
+    }
+}
+
+void batch_pool_stats(struct batch_pool_stats *stats){
+    stats->capacity = capacity;
+    stats->free_min = atomic_load(&free_min);
+    stats->refills = atomic_load(&refills);
+    stats->spills = atomic_load(&spills);
+    stats->exhausted = atomic_load(&exhausted);
+}
+
+void batch_pool_free(void){
+    cache.n = 0;
+    free(base);
+    free((void *)next);
+    base = NULL;
+    next = NULL;
+    capacity = 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file batch_pool.h
+ * @brief Preallocated pool of fixed-size sample batches for handing samples
+ * between threads without malloc/free on the sample path. Batches are
+ * cache-line aligned and touched at startup, so taking one never faults a
+ * page in. Each thread keeps a small cache of free batches and trades half
+ * of it at a time with a lock-free global freelist; only those trades and
+ * exhaustion touch shared state.
+ * @note One pool per process, sized once by batch_pool_init().
+ */
+
+#ifndef INC_BATCH_POOL_H_
+#define INC_BATCH_POOL_H_
+
+#include <stddef.h>
+
+#define BATCH_POOL_ALIGN 64  // cache line
+#define BATCH_POOL_CACHE 8   // free batches a thread keeps to itself
+
+struct batch_pool_stats {
+    unsigned capacity;       // batches in the pool
+    unsigned free_min;       // fewest batches seen on the global freelist
+    unsigned long refills;   // thread caches refilled from the global freelist
+    unsigned long spills;    // thread caches spilled back to it
+    unsigned long exhausted; // batch_pool_get() calls that found no batch
+};
+
+/**
+ * @brief Batches needed to buffer a sample stream
+ * @param samples_per_s expected sample rate
+ * @param per_batch samples in one batch
+ * @param buffer_s time the consumer may fall behind the producer
+ * @param threads threads that take or return batches (each caches some)
+ */
+unsigned batch_pool_count_for(double samples_per_s, unsigned per_batch, double buffer_s, int threads);
+
+/**
+ * @brief Allocate and pre-fault the pool
+ * @param batch_size bytes per batch, rounded up to BATCH_POOL_ALIGN
+ * @param count number of batches, at least 2 BATCH_POOL_CACHE + 2
+ * @return 0 on success, -1 on failure
+ */
+int batch_pool_init(size_t batch_size, unsigned count);
+
+/**
+ * @brief Take a free batch
+ * @return the batch, NULL when the pool is exhausted (counted)
+ */
+void *batch_pool_get(void);
+
+/**
+ * @brief Return a batch; any thread may return any batch
+ */
+void batch_pool_put(void *batch);
+
+/**
+ * @brief Hand the calling thread's cached batches back before it exits
+ */
+void batch_pool_thread_exit(void);
+
+void batch_pool_stats(struct batch_pool_stats *stats);
+
+/**
+ * @brief Free the pool; every batch must have been returned
+ */
+void batch_pool_free(void);
+
+#endif /* INC_BATCH_POOL_H_ */
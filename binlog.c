@@ -0,0 +1,328 @@
+#define _GNU_SOURCE // mremap()
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "batch_pool.h"
+#include "binlog.h"
+
+#define STALL_US 100 // wait for a free batch
+
+int binlog_create(struct binlog_writer *w, const char *path, const char *source, int64_t start_ns){
+    struct binlog_header hdr;
+
+    memset(w, 0, sizeof(*w));
+    w->batch = &w->own;
+    w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (w->fd == -1) {
+        syslog(LOG_ERR, "Failed to open binary log %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = BINLOG_MAGIC;
+    hdr.version = BINLOG_VERSION;
+    hdr.record_size = sizeof(struct binlog_record);
+    hdr.start_ns = start_ns;
+    strncpy(hdr.source, source != NULL ? source : "", sizeof(hdr.source) - 1);
+    if (write(w->fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+        syslog(LOG_ERR, "Failed to write binary log header: %s", strerror(errno));
+        close(w->fd);
+        w->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+static int write_batch(int fd, const struct binlog_batch *b){
+    // header and records in one write so a reader never sees half a block header
+    ssize_t len = sizeof(b->hdr) + b->hdr.count * sizeof(b->rec[0]);
+    if (write(fd, b, len) != len) {
+        syslog(LOG_ERR, "Failed to write binary log block: %s", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static void *write_loop(void *arg){
+    struct binlog_writer *w = arg;
+    for (;;) {
+        if (sem_wait(&w->queued) == -1) {
+            continue; // EINTR
+        }
+        unsigned tail = atomic_load_explicit(&w->ring_tail, memory_order_relaxed);
+        if (tail == atomic_load_explicit(&w->ring_head, memory_order_acquire)) {
+            break; // the wake-up binlog_close() sends after the last batch
+        }
+        struct binlog_batch *b = w->ring[tail & w->ring_mask];
+        if (write_batch(w->fd, b) == -1) {
+            atomic_store(&w->write_failed, 1);
+        }
+        atomic_store_explicit(&w->ring_tail, tail + 1, memory_order_release);
+        batch_pool_put(b);
+    }
+    batch_pool_thread_exit();
+    return NULL;
+}
+
+int binlog_start_writer(struct binlog_writer *w){
+    struct batch_pool_stats pool;
+    struct binlog_batch *b = batch_pool_get();
+
+    batch_pool_stats(&pool);
+    unsigned size = 1;
+    while (size < pool.capacity) {
+        size *= 2; // the ring can hold every batch, so it never fills
+    }
+    w->ring = malloc(size * sizeof(*w->ring));
+    if (b == NULL || w->ring == NULL || sem_init(&w->queued, 0, 0) == -1) {
+        syslog(LOG_ERR, "Failed to set up the binary log writer thread");
+        free(w->ring);
+        w->ring = NULL;
+        if (b != NULL) {
+            batch_pool_put(b);
+        }
+        return -1;
+    }
+    w->ring_mask = size - 1;
+    memcpy(b, w->batch, sizeof(b->hdr) + w->batch->hdr.count * sizeof(b->rec[0]));
+    w->batch = b;
+    if (pthread_create(&w->thread, NULL, write_loop, w) != 0) {
+        syslog(LOG_ERR, "Failed to start the binary log writer thread");
+        memcpy(&w->own, b, sizeof(*b));
+        w->batch = &w->own;
+        batch_pool_put(b);
+        sem_destroy(&w->queued);
+        free(w->ring);
+        w->ring = NULL;
+        return -1;
+    }
+    w->background = 1;
+    return 0;
+}
+
+int binlog_flush(struct binlog_writer *w){
+    struct binlog_batch *b = w->batch;
+
+    if (b->hdr.count == 0) {
+        return 0;
+    }
+    b->hdr.magic = BINLOG_BLOCK_MAGIC;
+    b->hdr.step = w->step;
+    b->hdr.cmd_val = w->cmd_val;
+    b->hdr.first_ns = b->rec[0].t_ns;
+    b->hdr.last_ns = b->rec[b->hdr.count - 1].t_ns;
+    if (!w->background) {
+        int ret = write_batch(w->fd, b);
+        b->hdr.count = 0;
+        return ret;
+    }
+
+    unsigned head = atomic_load_explicit(&w->ring_head, memory_order_relaxed);
+    w->ring[head & w->ring_mask] = b;
+    atomic_store_explicit(&w->ring_head, head + 1, memory_order_release);
+    sem_post(&w->queued);
+    while ((w->batch = batch_pool_get()) == NULL) {
+        w->stalls++;
+        usleep(STALL_US);
+    }
+    w->batch->hdr.count = 0;
+    return atomic_load(&w->write_failed) ? -1 : 0;
+}
+
+int binlog_step(struct binlog_writer *w, uint32_t step, int32_t cmd_val){
+    int ret = binlog_flush(w);
+    w->step = step;
+    w->cmd_val = cmd_val;
+    return ret;
+}
+
+int binlog_append(struct binlog_writer *w, int64_t t_ns, uint32_t code, uint8_t status){
+    struct binlog_record *rec = &w->batch->rec[w->batch->hdr.count++];
+    rec->t_ns = t_ns;
+    rec->code = code;
+    rec->status = status;
+    rec->flags = 0;
+    rec->reserved = 0;
+    if (w->batch->hdr.count == BINLOG_BLOCK_RECORDS) {
+        return binlog_flush(w);
+    }
+    return 0;
+}
+
+int binlog_close(struct binlog_writer *w){
+    int ret = binlog_flush(w);
+    if (w->background) {
+        sem_post(&w->queued); // finds the ring empty and stops
+        pthread_join(w->thread, NULL);
+        sem_destroy(&w->queued);
+        batch_pool_put(w->batch);
+        free(w->ring);
+        w->ring = NULL;
+        w->batch = &w->own;
+        w->background = 0;
+        ret |= atomic_load(&w->write_failed) ? -1 : 0;
+    }
+    if (w->fd >= 0 && close(w->fd) == -1) {
+        ret = -1;
+    }
+    w->fd = -1;
+    return ret;
+}
+
+
+/**
+ * @brief Hop over the block headers from r->indexed to the end of the map,
+ * extending the block and step index. A trailing partial block is left for
+ * a later call.
+ */
+static int index_blocks(struct binlog_reader *r){
+    int added = 0;
+    size_t off = r->indexed;
+
+    while (off + sizeof(struct binlog_block) <= r->size) {
+        const struct binlog_block *blk = (const struct binlog_block *)(r->map + off);
+        size_t len = sizeof(*blk) + (size_t)blk->count * sizeof(struct binlog_record);
+        if (blk->magic != BINLOG_BLOCK_MAGIC) {
+            syslog(LOG_ERR, "Corrupt binary log block at offset %zu", off);
+            return -1;
+        }
+        if (off + len > r->size) {
+            break; // still being written
+        }
+
+        if (r->num_blocks == r->blocks_cap) {
+            int cap = r->blocks_cap ? 2 * r->blocks_cap : 64;
+            size_t *grown = realloc(r->block_off, cap * sizeof(*grown));
+            if (grown == NULL) {
+                return -1;
+            }
+            r->block_off = grown;
+            r->blocks_cap = cap;
+        }
+        int b = r->num_blocks++;
+        r->block_off[b] = off;
+
+        struct binlog_step *st = r->num_steps ? &r->steps[r->num_steps - 1] : NULL;
+        if (st == NULL || st->step != blk->step || st->cmd_val != blk->cmd_val) {
+            if (r->num_steps == r->steps_cap) {
+                int cap = r->steps_cap ? 2 * r->steps_cap : 16;
+                struct binlog_step *grown = realloc(r->steps, cap * sizeof(*grown));
+                if (grown == NULL) {
+                    return -1;
+                }
+                r->steps = grown;
+                r->steps_cap = cap;
+            }
+            st = &r->steps[r->num_steps++];
+            memset(st, 0, sizeof(*st));
+            st->step = blk->step;
+            st->cmd_val = blk->cmd_val;
+            st->first_block = b;
+            st->first_ns = blk->first_ns;
+        }
+        st->count += blk->count;
+        st->num_blocks++;
+        st->last_ns = blk->last_ns;
+
+        off += len;
+        added++;
+    }
+    r->indexed = off;
+    return added;
+}
+
+int binlog_open(struct binlog_reader *r, const char *path){
+    struct stat sb;
+
+    memset(r, 0, sizeof(*r));
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        syslog(LOG_ERR, "Failed to open binary log %s: %s", path, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &sb) == -1 || (size_t)sb.st_size < sizeof(struct binlog_header)) {
+        syslog(LOG_ERR, "Binary log %s is too short", path);
+        close(fd);
+        return -1;
+    }
+
+    r->size = sb.st_size;
+    r->map = mmap(NULL, r->size, PROT_READ, MAP_SHARED, fd, 0);
+    if (r->map == MAP_FAILED) {
+        syslog(LOG_ERR, "Failed to map binary log %s: %s", path, strerror(errno));
+        close(fd);
+        r->map = NULL;
+        return -1;
+    }
+    r->fd = fd;
+    madvise((void *)r->map, r->size, MADV_SEQUENTIAL);
+
+    const struct binlog_header *hdr = binlog_header_of(r);
+    if (hdr->magic != BINLOG_MAGIC || hdr->version != BINLOG_VERSION ||
+        hdr->record_size != sizeof(struct binlog_record)) {
+        syslog(LOG_ERR, "%s is not a version %d binary log", path, BINLOG_VERSION);
+        binlog_reader_close(r);
+        return -1;
+    }
+
+    r->indexed = sizeof(struct binlog_header);
+    if (index_blocks(r) == -1) {
+        binlog_reader_close(r);
+        return -1;
+    }
+    return 0;
+}
+
+int binlog_refresh(struct binlog_reader *r){
+    struct stat sb;
+
+    if (fstat(r->fd, &sb) == -1) {
+        syslog(LOG_ERR, "Failed to stat binary log: %s", strerror(errno));
+        return -1;
+    }
+    if ((size_t)sb.st_size < r->size) {
+        syslog(LOG_ERR, "Binary log was truncated");
+        return -1;
+    }
+    if ((size_t)sb.st_size > r->size) {
+        // offsets, not pointers, are indexed, so the mapping may move
+        void *map = mremap((void *)r->map, r->size, sb.st_size, MREMAP_MAYMOVE);
+        if (map == MAP_FAILED) {
+            syslog(LOG_ERR, "Failed to extend binary log mapping: %s", strerror(errno));
+            return -1;
+        }
+        r->map = map;
+        r->size = sb.st_size;
+        size_t from = r->indexed & ~((size_t)sysconf(_SC_PAGESIZE) - 1);
+        madvise((void *)(r->map + from), r->size - from, MADV_SEQUENTIAL);
+    }
+    return index_blocks(r);
+}
+
+const struct binlog_header *binlog_header_of(const struct binlog_reader *r){
+    return (const struct binlog_header *)r->map;
+}
+
+const struct binlog_block *binlog_block_at(const struct binlog_reader *r, int b){
+    return (const struct binlog_block *)(r->map + r->block_off[b]);
+}
+
+const struct binlog_record *binlog_block_records(const struct binlog_reader *r, int b){
+    return (const struct binlog_record *)(r->map + r->block_off[b] + sizeof(struct binlog_block));
+}
+
+void binlog_reader_close(struct binlog_reader *r){
+    if (r->map != NULL) {
+        munmap((void *)r->map, r->size);
+        close(r->fd);
+    }
+    free(r->block_off);
+    free(r->steps);
+    memset(r, 0, sizeof(*r));
+}
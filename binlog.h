@@ -0,0 +1,159 @@
+/**
+ * @file binlog.h
+ * @brief Binary sample log with a step index. The file is a header followed
+ * by blocks; each block header carries its step, command value, record count
+ * and time range, so opening a log indexes every step by hopping from block
+ * header to block header without touching the samples.
+ */
+
+#ifndef INC_BINLOG_H_
+#define INC_BINLOG_H_
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BINLOG_MAGIC 0x42434C44u       // "LDCB"
+#define BINLOG_BLOCK_MAGIC 0x4B4C4C42u // "BLLK"
+#define BINLOG_VERSION 1
+#define BINLOG_BLOCK_RECORDS 256       // records buffered before a block is written
+#define BINLOG_CMD_UNKNOWN INT32_MIN   // command of steps ingested without one
+
+struct binlog_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    int64_t start_ns;      // CLOCK_REALTIME at t = 0
+    char source[48];       // rig, host or original file name
+};
+
+struct binlog_block {
+    uint32_t magic;
+    uint32_t step;
+    int32_t cmd_val;
+    uint32_t count;        // records following this header
+    int64_t first_ns;
+    int64_t last_ns;
+};
+
+struct binlog_record {
+    int64_t t_ns;          // since start of run
+    uint32_t code;         // LHR data code
+    uint8_t status;        // LHR_STATUS at conversion time
+    uint8_t flags;
+    uint16_t reserved;
+};
+
+// A block as it is written: header and records in one piece
+struct binlog_batch {
+    struct binlog_block hdr;
+    struct binlog_record rec[BINLOG_BLOCK_RECORDS];
+};
+
+struct binlog_writer {
+    int fd;
+    uint32_t step;
+    int32_t cmd_val;
+    struct binlog_batch *batch;  // being filled: own, or one from the batch pool
+    struct binlog_batch own;
+    // background writing, see binlog_start_writer()
+    int background;
+    pthread_t thread;
+    sem_t queued;
+    struct binlog_batch **ring;  // full batches on their way to the writer thread
+    unsigned ring_mask;
+    atomic_uint ring_head;
+    atomic_uint ring_tail;
+    atomic_int write_failed;
+    unsigned long stalls;        // flushes that waited for a free batch
+};
+
+// One step of an opened log; its records may span several blocks
+struct binlog_step {
+    uint32_t step;
+    int32_t cmd_val;
+    uint64_t count;
+    int first_block;
+    int num_blocks;
+    int64_t first_ns;
+    int64_t last_ns;
+};
+
+struct binlog_reader {
+    int fd;                // kept open for binlog_refresh()
+    const unsigned char *map;
+    size_t size;
+    size_t indexed;        // bytes covered by complete blocks
+    size_t *block_off;     // file offset of each block header
+    int num_blocks;
+    int blocks_cap;
+    struct binlog_step *steps;
+    int num_steps;
+    int steps_cap;
+};
+
+/**
+ * @brief Create (truncate) a binary log and write its header
+ * @param w writer
+ * @param path file name
+ * @param source free text stored in the header
+ * @param start_ns wall clock time of t = 0, ns since the epoch
+ * @return 0 on success, -1 on failure
+ */
+int binlog_create(struct binlog_writer *w, const char *path, const char *source, int64_t start_ns);
+
+/**
+ * @brief Move the file writes to a thread of their own. Full blocks are
+ * handed over in batches from the batch pool (batch_pool.h), which the
+ * caller must have initialised with sizeof(struct binlog_batch) batches;
+ * appends then never wait for the disk, only for a free batch when the
+ * pool runs dry (counted in stalls).
+ * @return 0 on success, -1 on failure (the writer stays synchronous)
+ */
+int binlog_start_writer(struct binlog_writer *w);
+
+/**
+ * @brief Start a new step; the records buffered so far are written out
+ * @return 0 on success, -1 on failure
+ */
+int binlog_step(struct binlog_writer *w, uint32_t step, int32_t cmd_val);
+
+/**
+ * @brief Append one record, writing a block when the buffer is full
+ * @return 0 on success, -1 on failure
+ */
+int binlog_append(struct binlog_writer *w, int64_t t_ns, uint32_t code, uint8_t status);
+
+int binlog_flush(struct binlog_writer *w);
+
+int binlog_close(struct binlog_writer *w);
+
+/**
+ * @brief Map a log read-only and build its block and step index
+ * @return 0 on success, -1 on failure
+ */
+int binlog_open(struct binlog_reader *r, const char *path);
+
+/**
+ * @brief Follow a log that is still being written: map the bytes appended
+ * since the last open/refresh and index the complete blocks among them.
+ * Existing block and step entries keep their numbers; the last step may
+ * gain blocks.
+ * @return number of blocks added, -1 on failure
+ */
+int binlog_refresh(struct binlog_reader *r);
+
+const struct binlog_header *binlog_header_of(const struct binlog_reader *r);
+
+const struct binlog_block *binlog_block_at(const struct binlog_reader *r, int b);
+
+/**
+ * @brief Records of block b
+ */
+const struct binlog_record *binlog_block_records(const struct binlog_reader *r, int b);
+
+void binlog_reader_close(struct binlog_reader *r);
+
+#endif /* INC_BINLOG_H_ */
@@ -0,0 +1,220 @@
+#define _XOPEN_SOURCE 700 // strptime()
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+#include "catalog.h"
+
+enum field_type { F_TEXT, F_TIME, F_DOUBLE, F_FLOAT, F_I16, F_U16, F_I32, F_U64 };
+enum filter_op { OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE, OP_CONTAINS };
+
+struct field {
+    const char *name;
+    enum field_type type;
+    size_t offset;
+    size_t len; // text fields
+};
+
+#define FIELD(n, t) {#n, t, offsetof(struct catalog_entry, n), sizeof(((struct catalog_entry *)0)->n)}
+
+static const struct field fields[] = {
+    FIELD(start_ns, F_TIME),
+    FIELD(duration_s, F_DOUBLE),
+    FIELD(rig, F_TEXT),
+    FIELD(sensor, F_TEXT),
+    FIELD(log, F_TEXT),
+    FIELD(binlog, F_TEXT),
+    FIELD(rcount, F_U16),
+    FIELD(fast_rcount, F_U16),
+    FIELD(slope_thresh, F_FLOAT),
+    FIELD(num_samples, F_I32),
+    FIELD(num_steps, F_I32),
+    FIELD(start_cmd, F_I16),
+    FIELD(cmd_inc, F_I16),
+    FIELD(max_cmd, F_I16),
+    FIELD(steps_done, F_I32),
+    FIELD(samples, F_U64),
+    FIELD(enob_mean, F_FLOAT),
+    FIELD(enob_min, F_FLOAT),
+    FIELD(noise_rms_max, F_FLOAT),
+    FIELD(snr_db_mean, F_FLOAT),
+};
+#define NUM_FIELDS (int)(sizeof(fields) / sizeof(fields[0]))
+
+void catalog_entry_init(struct catalog_entry *e){
+    memset(e, 0, sizeof(*e));
+    e->magic = CATALOG_MAGIC;
+    e->version = CATALOG_VERSION;
+    e->size = sizeof(*e);
+}
+
+int catalog_append(const char *path, const struct catalog_entry *e){
+    // O_APPEND makes each record land whole at the end, even with concurrent runs
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0666);
+    if (fd == -1) {
+        syslog(LOG_ERR, "Failed to open run catalog %s: %s", path, strerror(errno));
+        return -1;
+    }
+    ssize_t n = write(fd, e, sizeof(*e));
+    close(fd);
+    if (n != sizeof(*e)) {
+        syslog(LOG_ERR, "Failed to append to run catalog %s: %s", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int catalog_read(FILE *f, struct catalog_entry *e){
+    const size_t head = offsetof(struct catalog_entry, start_ns);
+    memset(e, 0, sizeof(*e));
+    if (fread(e, head, 1, f) != 1) {
+        return 0;
+    }
+    if (e->magic != CATALOG_MAGIC || e->size < CATALOG_V1_SIZE || e->size > sizeof(*e)) {
+        return -1;
+    }
+    // the fields a record of an older version lacks stay zero
+    return fread((char *)e + head, e->size - head, 1, f) == 1 ? 1 : -1;
+}
+
+static double field_num(const struct field *fd, const struct catalog_entry *e){
+    const char *p = (const char *)e + fd->offset;
+    switch (fd->type) {
+        case F_TIME:   return *(const int64_t *)p / 1e9;
+        case F_DOUBLE: return *(const double *)p;
+        case F_FLOAT:  return *(const float *)p;
+        case F_I16:    return *(const int16_t *)p;
+        case F_U16:    return *(const uint16_t *)p;
+        case F_I32:    return *(const int32_t *)p;
+        case F_U64:    return (double)*(const uint64_t *)p;
+        default:       return 0;
+    }
+}
+
+/**
+ * @brief Time values are seconds since the epoch or local "YYYY-mm-dd[THH:MM[:SS]]"
+ */
+static int parse_time(const char *s, double *out){
+    const char *formats[] = {"%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M", "%Y-%m-%d"};
+    for (int i = 0; i < 3; i++) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        const char *end = strptime(s, formats[i], &tm);
+        if (end != NULL && *end == '\0') {
+            tm.tm_isdst = -1;
+            *out = (double)mktime(&tm);
+            return 0;
+        }
+    }
+    char *end;
+    *out = strtod(s, &end);
+    return *end == '\0' ? 0 : -1;
+}
+
+int catalog_filter_parse(struct catalog_filter *f, const char *expr){
+    static const char *ops[] = {"!=", "<=", ">=", "=", "<", ">", "~"};
+    static const int op_codes[] = {OP_NE, OP_LE, OP_GE, OP_EQ, OP_LT, OP_GT, OP_CONTAINS};
+    const char *at = NULL;
+    int op = -1;
+
+    // first operator character in the expression, longest match
+    size_t pos = strcspn(expr, "!<>=~");
+    if (expr[pos] == '\0') {
+        return -1;
+    }
+    for (int i = 0; i < 7; i++) {
+        if (strncmp(expr + pos, ops[i], strlen(ops[i])) == 0) {
+            at = expr + pos;
+            op = i;
+            break;
+        }
+    }
+    if (at == NULL) {
+        return -1;
+    }
+
+    memset(f, 0, sizeof(*f));
+    f->field = -1;
+    for (int i = 0; i < NUM_FIELDS; i++) {
+        size_t len = strlen(fields[i].name);
+        if ((size_t)(at - expr) == len && strncmp(expr, fields[i].name, len) == 0) {
+            f->field = i;
+        } else if (i == 0 && (size_t)(at - expr) == 5 && strncmp(expr, "start", 5) == 0) {
+            f->field = 0; // "start" is accepted for start_ns
+        }
+    }
+    if (f->field < 0) {
+        return -1;
+    }
+
+    f->op = op_codes[op];
+    const char *value = at + strlen(ops[op]);
+    strncpy(f->text, value, sizeof(f->text) - 1);
+    const struct field *fd = &fields[f->field];
+    if (fd->type == F_TIME) {
+        return parse_time(value, &f->num);
+    }
+    if (fd->type != F_TEXT) {
+        char *end;
+        f->num = strtod(value, &end);
+        return (*end == '\0' && f->op != OP_CONTAINS) ? 0 : -1;
+    }
+    return 0;
+}
+
+int catalog_filter_match(const struct catalog_filter *f, const struct catalog_entry *e){
+    const struct field *fd = &fields[f->field];
+    int c;
+    if (fd->type == F_TEXT) {
+        const char *s = (const char *)e + fd->offset;
+        if (f->op == OP_CONTAINS) {
+            return strstr(s, f->text) != NULL;
+        }
+        c = strncmp(s, f->text, fd->len);
+    } else {
+        double v = field_num(fd, e);
+        c = (v > f->num) - (v < f->num);
+    }
+    switch (f->op) {
+        case OP_EQ: return c == 0;
+        case OP_NE: return c != 0;
+        case OP_LT: return c < 0;
+        case OP_LE: return c <= 0;
+        case OP_GT: return c > 0;
+        case OP_GE: return c >= 0;
+        default:    return 0;
+    }
+}
+
+static void format_time(char *buf, size_t len, int64_t ns){
+    time_t t = (time_t)(ns / 1000000000);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    strftime(buf, len, "%Y-%m-%dT%H:%M:%S", &tm);
+}
+
+void catalog_print(FILE *out, const struct catalog_entry *e, int all_fields){
+    char when[32];
+    format_time(when, sizeof(when), e->start_ns);
+    if (!all_fields) {
+        fprintf(out, "%s  %-12s %-12s steps %3d/%-3d samples %8llu  enob %5.2f  %s\n", when,
+                e->rig, e->sensor, e->steps_done, e->num_steps, (unsigned long long)e->samples,
+                e->enob_mean, e->log);
+        return;
+    }
+    for (int i = 0; i < NUM_FIELDS; i++) {
+        const struct field *fd = &fields[i];
+        if (fd->type == F_TEXT) {
+            fprintf(out, "%s=%.*s ", fd->name, (int)fd->len, (const char *)e + fd->offset);
+        } else if (fd->type == F_TIME) {
+            fprintf(out, "%s=%s ", fd->name, when);
+        } else {
+            fprintf(out, "%s=%g ", fd->name, field_num(fd, e));
+        }
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,94 @@
+/**
+ * @file catalog.h
+ * @brief Run catalog: one fixed-size record per capture appended to an index
+ * file, holding the run's configuration, sweep plan, identity and summary
+ * metrics, so runs can be found without opening their logs.
+ */
+
+#ifndef INC_CATALOG_H_
+#define INC_CATALOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define CATALOG_DEFAULT "./testing/ldc1101_catalog.idx"
+#define CATALOG_MAGIC 0x47544143u // "CATG"
+#define CATALOG_VERSION 2 // 2: slope_thresh appended, version 1 records are read zero-filled
+
+struct catalog_entry {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;          // sizeof(struct catalog_entry)
+    int64_t start_ns;       // wall clock, ns since the epoch
+    double duration_s;
+    char rig[24];
+    char sensor[24];
+    char log[96];           // CSV log path
+    char binlog[64];        // binary log path, empty if none
+    // configuration
+    uint16_t rcount;        // high resolution RCOUNT, the last one applied
+    uint16_t fast_rcount;   // 0 unless adaptive RCOUNT was on
+    int32_t num_samples;    // per step
+    // sweep plan
+    int32_t num_steps;
+    int16_t start_cmd;
+    int16_t cmd_inc;
+    int16_t max_cmd;
+    int16_t reserved;
+    // summary
+    int32_t steps_done;
+    uint64_t samples;
+    float enob_mean;
+    float enob_min;
+    float noise_rms_max;
+    float snr_db_mean;
+    // version 2
+    float slope_thresh;     // adaptive RCOUNT switch threshold, 0 unless adaptive RCOUNT was on
+    uint32_t reserved2;
+};
+
+#define CATALOG_V1_SIZE offsetof(struct catalog_entry, slope_thresh)
+
+/**
+ * @brief Fill magic/version/size; the caller sets the remaining fields
+ */
+void catalog_entry_init(struct catalog_entry *e);
+
+/**
+ * @brief Append one entry to the catalog file (created if missing)
+ * @return 0 on success, -1 on failure
+ */
+int catalog_append(const char *path, const struct catalog_entry *e);
+
+/**
+ * @brief Read the next entry of a catalog file; records of an older version
+ * are zero-filled to the current layout
+ * @return 1 on an entry, 0 at the end of the file, -1 on a corrupt record
+ */
+int catalog_read(FILE *f, struct catalog_entry *e);
+
+/**
+ * @brief Parsed "field<op>value" filter, op one of = != < <= > >= ~ (contains)
+ */
+struct catalog_filter {
+    int field;
+    int op;
+    double num;
+    char text[96];
+};
+
+/**
+ * @brief Parse a filter expression such as "rig=bench2" or "enob_mean>18"
+ * @return 0 on success, -1 on an unknown field or operator
+ */
+int catalog_filter_parse(struct catalog_filter *f, const char *expr);
+
+int catalog_filter_match(const struct catalog_filter *f, const struct catalog_entry *e);
+
+/**
+ * @brief Print an entry, all fields as name=value or a one-line summary
+ */
+void catalog_print(FILE *out, const struct catalog_entry *e, int all_fields);
+
+#endif /* INC_CATALOG_H_ */
@@ -0,0 +1,227 @@
+#include <stdlib.h>
+#include <string.h>
+#include "csv_scan.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define SWAR_ONES 0x0101010101010101ull
+#define SWAR_HIGHS 0x8080808080808080ull
+#define SWAR_LITTLE_ENDIAN (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+
+/**
+ * @brief Bit i of the result is set when p[i] == c, for i in 0..63
+ */
+static inline uint64_t match64(const char *p, char c){
+#if defined(__SSE2__)
+    __m128i needle = _mm_set1_epi8(c);
+    uint64_t m0 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), needle));
+    uint64_t m1 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 16)), needle));
+    uint64_t m2 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 32)), needle));
+    uint64_t m3 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 48)), needle));
+    return m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+#elif defined(__ARM_NEON)
+    // NEON has no movemask: narrow each 16 byte compare to a 4 bit/byte mask
+    uint8x16_t needle = vdupq_n_u8((uint8_t)c);
+    uint64_t mask = 0;
+    for (int k = 0; k < 4; k++) {
+        uint8x16_t eq = vceqq_u8(vld1q_u8((const uint8_t *)p + 16 * k), needle);
+        uint64_t nib = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        for (int i = 0; i < 16; i++) {
+            mask |= ((nib >> (4 * i)) & 1ull) << (16 * k + i);
+        }
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+    uint64_t pattern = SWAR_ONES * (uint8_t)c;
+    for (int k = 0; k < 8; k++) {
+        uint64_t w;
+        memcpy(&w, p + 8 * k, 8);
+        w ^= pattern; // matching bytes become zero
+        uint64_t z = ~(((w & ~SWAR_HIGHS) + ~SWAR_HIGHS) | w | ~SWAR_HIGHS);
+        for (int i = 0; i < 8; i++) {
+            int byte = SWAR_LITTLE_ENDIAN ? i : 7 - i;
+            mask |= ((z >> (8 * byte + 7)) & 1ull) << (8 * k + i);
+        }
+    }
+    return mask;
+#endif
+}
+
+/**
+ * @brief Convert exactly eight ASCII digits
+ * @return value, or -1 if any byte is not a digit
+ */
+static inline int64_t parse8(const char *p){
+#if SWAR_LITTLE_ENDIAN
+    uint64_t v;
+    memcpy(&v, p, 8);
+    // every byte must be 0x30..0x39: high nibble 3, and still 3 after adding 6
+    if ((((v & 0xF0F0F0F0F0F0F0F0ull) | (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4))) !=
+        0x3333333333333333ull) {
+        return -1;
+    }
+    v -= 0x3030303030303030ull;
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+         (((v >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+    return (int64_t)v;
+#else
+    int64_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return -1;
+        }
+        v = v * 10 + (p[i] - '0');
+    }
+    return v;
+#endif
+}
+
+/**
+ * @brief Convert 1..16 ASCII digits
+ * @return value, or -1 on a non-digit or bad length
+ */
+static inline int64_t parse_digits(const char *p, size_t n){
+    char pad[16];
+    if (n == 0 || n > 16) {
+        return -1;
+    }
+    // right-align into zero padding so the fixed-width path does the work
+    memset(pad, '0', sizeof(pad));
+    memcpy(pad + sizeof(pad) - n, p, n);
+    int64_t hi = parse8(pad);
+    int64_t lo = parse8(pad + 8);
+    if (hi < 0 || lo < 0) {
+        return -1;
+    }
+    return hi * 100000000 + lo;
+}
+
+/**
+ * @brief Parse one line (without its newline) given the offset of its comma
+ * @return 0 on success, -1 if the line is not a data line
+ */
+static inline int parse_line(const char *line, size_t len, size_t comma,
+                             int64_t *t_ns, uint32_t *code){
+    const char *dot = memchr(line, '.', comma);
+    if (dot == NULL || comma - (dot - line) != 10) {
+        return -1; // need exactly 9 nanosecond digits
+    }
+    int64_t sec = parse_digits(line, dot - line);
+    int64_t nsec = parse8(dot + 1);
+    char last = dot[9];
+    if (sec < 0 || nsec < 0 || last < '0' || last > '9') {
+        return -1;
+    }
+    nsec = nsec * 10 + (last - '0');
+
+    size_t v = comma + 1;
+    while (v < len && line[v] == ' ') {
+        v++;
+    }
+    // later columns (e.g. the drift-corrected value) are not needed
+    const char *next = memchr(line + v, ',', len - v);
+    size_t end = next != NULL ? (size_t)(next - line) : len;
+    while (end > v && (line[end - 1] == '\r' || line[end - 1] == ' ')) {
+        end--;
+    }
+    int64_t value = parse_digits(line + v, end - v);
+    if (value < 0 || value > UINT32_MAX) {
+        return -1;
+    }
+    *t_ns = sec * 1000000000 + nsec;
+    *code = (uint32_t)value;
+    return 0;
+}
+
+static int grow(struct csv_samples *out){
+    size_t cap = out->cap ? 2 * out->cap : 4096;
+    int64_t *t = realloc(out->t_ns, cap * sizeof(*t));
+    if (t == NULL) {
+        return -1;
+    }
+    out->t_ns = t;
+    uint32_t *c = realloc(out->code, cap * sizeof(*c));
+    if (c == NULL) {
+        return -1;
+    }
+    out->code = c;
+    out->cap = cap;
+    return 0;
+}
+
+static int emit(struct csv_samples *out, const char *line, size_t len, long comma){
+    int64_t t;
+    uint32_t code;
+    if (comma < 0 || line[0] < '0' || line[0] > '9' ||
+        parse_line(line, len, (size_t)comma, &t, &code) == -1) {
+        out->skipped++;
+        return 0;
+    }
+    if (out->count == out->cap && grow(out) == -1) {
+        return -1;
+    }
+    out->t_ns[out->count] = t;
+    out->code[out->count] = code;
+    out->count++;
+    return 0;
+}
+
+int csv_scan(const char *buf, size_t len, struct csv_samples *out){
+    size_t line_start = 0;
+    long comma = -1; // first comma of the current line, relative to line_start
+    size_t pos = 0;
+    char tail[64];
+
+    while (pos < len) {
+        const char *chunk = buf + pos;
+        size_t n = len - pos < 64 ? len - pos : 64;
+        if (n < 64) { // last partial chunk: scan a padded copy
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, chunk, n);
+            chunk = tail;
+        }
+        uint64_t nl = match64(chunk, '\n');
+        uint64_t cm = match64(chunk, ',');
+        if (n < 64) {
+            nl &= (1ull << n) - 1;
+            cm &= (1ull << n) - 1;
+        }
+
+        // walk newlines in order, picking up the first comma before each
+        while (nl) {
+            size_t i = __builtin_ctzll(nl);
+            uint64_t before = cm & ((1ull << i) - 1);
+            if (comma < 0 && before) {
+                comma = (long)(pos + __builtin_ctzll(before) - line_start);
+            }
+            if (pos + i > line_start &&
+                emit(out, buf + line_start, pos + i - line_start, comma) == -1) {
+                return -1;
+            }
+            line_start = pos + i + 1;
+            comma = -1;
+            cm &= ~((2ull << i) - 1); // drop commas of the finished line
+            nl &= nl - 1;
+        }
+        if (comma < 0 && cm) {
+            comma = (long)(pos + __builtin_ctzll(cm) - line_start);
+        }
+        pos += n;
+    }
+    if (line_start < len && emit(out, buf + line_start, len - line_start, comma) == -1) {
+        return -1;
+    }
+    return 0;
+}
+
+void csv_samples_free(struct csv_samples *s){
+    free(s->t_ns);
+    free(s->code);
+    memset(s, 0, sizeof(*s));
+}
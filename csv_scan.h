@@ -0,0 +1,34 @@
+/**
+ * @file csv_scan.h
+ * @brief Vectorised parser for the "Timestamp, Value" data logs written by
+ * main(): "<sec>.<9 digit nsec>, <code>" per line. Newlines and commas are
+ * located 64 bytes at a time (SSE2, NEON or 8 byte SWAR words) and the
+ * digit runs are converted eight at a time.
+ */
+
+#ifndef INC_CSV_SCAN_H_
+#define INC_CSV_SCAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct csv_samples {
+    int64_t *t_ns;
+    uint32_t *code;
+    size_t count;
+    size_t cap;
+    size_t skipped;   // header, '#' tag and malformed lines
+};
+
+/**
+ * @brief Parse a whole log held in memory
+ * @param buf file contents
+ * @param len bytes in buf
+ * @param out samples, grown as needed; free with csv_samples_free()
+ * @return 0 on success, -1 on allocation failure
+ */
+int csv_scan(const char *buf, size_t len, struct csv_samples *out);
+
+void csv_samples_free(struct csv_samples *s);
+
+#endif /* INC_CSV_SCAN_H_ */
@@ -0,0 +1,96 @@
+#include <math.h>
+#include "cusum.h"
+
+void cusum_init(struct cusum *c, double k, double h){
+    c->k = k;
+    c->h = h;
+    cusum_rearm(c);
+}
+
+void cusum_rearm(struct cusum *c){
+    c->n = 0;
+    c->mean = 0;
+    c->trend = 0;
+    c->var = 0;
+    c->s_hi = c->s_lo = 0;
+    c->zero_hi = c->zero_lo = 0;
+    c->onset = 0;
+}
+
+/**
+ * @brief Least-squares line through the warm-up samples: level at the last
+ * one, slope, and the residual variance
+ */
+static void fit_reference(struct cusum *c){
+    const int m = CUSUM_WARMUP;
+    double mid = (m - 1) / 2.0;
+    double mean = 0, sxy = 0, sxx = 0, rss = 0;
+
+    for (int j = 0; j < m; j++) {
+        mean += c->warm[j] / m;
+    }
+    for (int j = 0; j < m; j++) {
+        sxy += (j - mid) * (c->warm[j] - mean);
+        sxx += (j - mid) * (j - mid);
+    }
+    c->trend = sxy / sxx;
+    c->mean = mean + c->trend * mid;
+    for (int j = 0; j < m; j++) {
+        double r = c->warm[j] - c->mean - c->trend * (j - (m - 1));
+        rss += r * r;
+    }
+    c->var = rss / (m - 2);
+    if (c->var < CUSUM_SIGMA_MIN * CUSUM_SIGMA_MIN) {
+        c->var = CUSUM_SIGMA_MIN * CUSUM_SIGMA_MIN;
+    }
+}
+
+int cusum_add(struct cusum *c, double x){
+    int i = c->n++;
+    if (i < CUSUM_SKIP) {
+        return 0;
+    }
+    if (i < CUSUM_SKIP + CUSUM_WARMUP) {
+        c->warm[i - CUSUM_SKIP] = x;
+        if (i == CUSUM_SKIP + CUSUM_WARMUP - 1) {
+            fit_reference(c);
+            c->zero_hi = c->zero_lo = c->n;
+        }
+        return 0;
+    }
+
+    double last = c->mean;
+    double pred = last + c->trend;
+    double e = x - pred;
+    double z = e / sqrt(c->var);
+    c->s_hi = fmax(0, c->s_hi + z - c->k);
+    c->s_lo = fmax(0, c->s_lo - z - c->k);
+    if (c->s_hi == 0) {
+        c->zero_hi = c->n;
+    }
+    if (c->s_lo == 0) {
+        c->zero_lo = c->n;
+    }
+
+    // follow slow drift; the gains are small enough that a shift is
+    // detected long before the level has taken it in
+    c->mean = pred + CUSUM_TRACK_LEVEL * e;
+    c->trend += CUSUM_TRACK_TREND * (c->mean - last - c->trend);
+    if (fabs(z) < CUSUM_NOISE_GATE) {
+        c->var += CUSUM_TRACK_NOISE * (e * e - c->var);
+    }
+
+    if (c->s_hi > c->h) {
+        c->onset = c->zero_hi;
+        return 1;
+    }
+    if (c->s_lo > c->h) {
+        c->onset = c->zero_lo;
+        return -1;
+    }
+    return 0;
+}
+
+double cusum_sigma(const struct cusum *c){
+    return sqrt(c->var);
+}
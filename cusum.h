@@ -0,0 +1,64 @@
+/**
+ * @file cusum.h
+ * @brief Online two-sided CUSUM change detection on the LHR codes of a step.
+ * After each re-arm the detector skips the settling samples, fits the
+ * step's level, slope and noise to the next few, then accumulates the
+ * standardised deviations from the predicted level beyond an allowance in
+ * both directions:
+ *   s+ = max(0, s+ + z - k),  s- = max(0, s- - z - k),  z = (x - pred) / sigma
+ * An alarm is raised when either sum passes h. It reacts within a couple
+ * of samples to a shift of a few sigma, at a false alarm rate set by h.
+ * The prediction and the noise follow slow baseline drift through a
+ * level/trend (Holt) filter of small gains, so a sudden change is detected
+ * well before the filter has learned it away.
+ * @note Re-arm whenever the expected level or the noise changes: a new
+ * command, an RCOUNT change.
+ */
+
+#ifndef INC_CUSUM_H_
+#define INC_CUSUM_H_
+
+#define CUSUM_K_DEFAULT 0.5    // allowance, sigma: detects shifts of about 2k best
+#define CUSUM_H_DEFAULT 8.0    // threshold, sigma
+#define CUSUM_SKIP 1           // settling samples after a re-arm (the conversion spanning the move)
+#define CUSUM_WARMUP 16        // samples the reference level, slope and noise are fitted to
+#define CUSUM_SIGMA_MIN 1.0    // codes, noise floor of the standardisation
+#define CUSUM_TRACK_LEVEL 0.2  // level gain of the drift tracking
+#define CUSUM_TRACK_TREND 0.05 // trend gain of the drift tracking
+#define CUSUM_TRACK_NOISE 0.02 // gain of the noise variance tracking
+#define CUSUM_NOISE_GATE 3.0   // sigma, larger deviations are kept out of the noise estimate
+
+struct cusum {
+    double k;               // allowance, sigma
+    double h;               // threshold, sigma
+    int n;                  // samples since the re-arm
+    double warm[CUSUM_WARMUP]; // samples the reference is fitted to
+    double mean;            // reference level at the last sample, codes
+    double trend;           // codes per sample
+    double var;             // reference noise variance, codes^2, 0 while learning
+    double s_hi;
+    double s_lo;
+    int zero_hi;            // last sample each sum was zero at, the change-point estimate
+    int zero_lo;
+    int onset;              // estimated first changed sample of the last alarm, since the re-arm
+};
+
+void cusum_init(struct cusum *c, double k, double h);
+
+/**
+ * @brief Forget the reference level and learn it again from the next samples
+ */
+void cusum_rearm(struct cusum *c);
+
+/**
+ * @brief Add one sample
+ * @return +1 on an upward alarm, -1 on a downward alarm, 0 otherwise
+ */
+int cusum_add(struct cusum *c, double x);
+
+/**
+ * @brief Current noise estimate, codes
+ */
+double cusum_sigma(const struct cusum *c);
+
+#endif /* INC_CUSUM_H_ */
@@ -0,0 +1,64 @@
+#include <string.h>
+#include "drift.h"
+
+void drift_init(struct drift_track *d, enum drift_model model){
+    memset(d, 0, sizeof(*d));
+    d->model = model;
+}
+
+void drift_add_point(struct drift_track *d, double t, double y){
+    if (d->num_points == 0) {
+        d->base = y;
+    }
+    d->num_points++;
+
+    // Welford update of the line fit, as in step_stats_add()
+    double dt = t - d->mean_t;
+    double dy = y - d->mean_y;
+    d->mean_t += dt / d->num_points;
+    d->mean_y += dy / d->num_points;
+    d->m2_t += dt * (t - d->mean_t);
+    d->c_ty += dt * (y - d->mean_y);
+
+    d->last_t[0] = d->last_t[1];
+    d->last_y[0] = d->last_y[1];
+    d->last_t[1] = t;
+    d->last_y[1] = y;
+}
+
+double drift_rate(const struct drift_track *d){
+    if (d->num_points < 2) {
+        return 0;
+    }
+    if (d->model == DRIFT_PIECEWISE) {
+        double dt = d->last_t[1] - d->last_t[0];
+        return dt > 0 ? (d->last_y[1] - d->last_y[0]) / dt : 0;
+    }
+    return d->m2_t > 0 ? d->c_ty / d->m2_t : 0;
+}
+
+double drift_offset(const struct drift_track *d, double t){
+    if (d->num_points < 2) {
+        return 0;
+    }
+    if (d->model == DRIFT_PIECEWISE) {
+        // extrapolate the newest segment; samples never precede the last revisit
+        return d->last_y[1] + drift_rate(d) * (t - d->last_t[1]) - d->base;
+    }
+    return d->mean_y + drift_rate(d) * (t - d->mean_t) - d->base;
+}
+
+int drift_parse_model(const char *name, enum drift_model *model){
+    if (strcmp(name, "linear") == 0) {
+        *model = DRIFT_LINEAR;
+    } else if (strcmp(name, "piecewise") == 0) {
+        *model = DRIFT_PIECEWISE;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+const char *drift_model_name(enum drift_model model){
+    return model == DRIFT_PIECEWISE ? "piecewise" : "linear";
+}
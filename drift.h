@@ -0,0 +1,63 @@
+/**
+ * @file drift.h
+ * @brief Online tracking of the LHR baseline drift from periodic revisits to
+ * a reference command. Every revisit gives one (time, mean code) point; the
+ * drift at any later time is predicted from the points seen so far, so
+ * samples can be corrected while the sweep is running.
+ */
+
+#ifndef INC_DRIFT_H_
+#define INC_DRIFT_H_
+
+#define DRIFT_REVISIT_SAMPLES 50 // samples averaged per revisit
+#define DRIFT_SETTLE_US 100000   // actuator settling before a revisit is sampled
+
+enum drift_model {
+    DRIFT_LINEAR = 0,   // least-squares line through all revisits
+    DRIFT_PIECEWISE = 1 // line through the last two revisits (linear spline)
+};
+
+struct drift_track {
+    enum drift_model model;
+    int num_points;
+    double base;             // reference level of the first revisit, codes
+    double mean_t;           // running least-squares fit of the revisits
+    double mean_y;
+    double m2_t;
+    double c_ty;
+    double last_t[2];        // two most recent revisits, [1] is the newest
+    double last_y[2];
+};
+
+/**
+ * @brief Start with no revisits (zero drift)
+ */
+void drift_init(struct drift_track *d, enum drift_model model);
+
+/**
+ * @brief Add the mean of one reference revisit
+ * @param t time of the revisit in seconds (e.g. mean sample time)
+ * @param y mean code at the reference command
+ */
+void drift_add_point(struct drift_track *d, double t, double y);
+
+/**
+ * @brief Predicted baseline drift at time t relative to the first revisit
+ * @return codes to subtract from a raw code, 0 before two revisits exist
+ */
+double drift_offset(const struct drift_track *d, double t);
+
+/**
+ * @brief Current drift rate in codes/s
+ */
+double drift_rate(const struct drift_track *d);
+
+/**
+ * @brief Parse "linear" or "piecewise"
+ * @return 0 on success, -1 on an unknown name
+ */
+int drift_parse_model(const char *name, enum drift_model *model);
+
+const char *drift_model_name(enum drift_model model);
+
+#endif /* INC_DRIFT_H_ */
@@ -0,0 +1,70 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hadamard.h"
+
+int hadamard_sign(int row, int col){
+    // Sylvester construction: H[r][c] = (-1)^popcount(r & c)
+    return __builtin_parity(row & col) ? -1 : 1;
+}
+
+int hadamard_id_init(struct hadamard_id *h, int channels, int16_t center, int16_t amplitude){
+    if (channels < 1 || channels > HADAMARD_MAX_CHANNELS || amplitude < 0 ||
+        abs(center) + amplitude > INT16_MAX) {
+        return -1; // center +/- amplitude must fit a command
+    }
+    memset(h, 0, sizeof(*h));
+    h->channels = channels;
+    h->center = center;
+    h->amplitude = amplitude;
+    return 0;
+}
+
+/**
+ * @brief Matrix row applied at the current position of the cycle; odd cycles
+ * run the rows backwards so a linear drift cancels over a pair of cycles
+ */
+static int current_row(const struct hadamard_id *h){
+    return h->cycles % 2 ? HADAMARD_ORDER - 1 - h->pattern : h->pattern;
+}
+
+void hadamard_pattern(const struct hadamard_id *h, int16_t *values){
+    for (int j = 0; j < h->channels; j++) {
+        values[j] = h->center + hadamard_sign(current_row(h), j + 1) * h->amplitude;
+    }
+}
+
+int hadamard_id_add(struct hadamard_id *h, double y){
+    h->y[current_row(h)] = y;
+    h->pattern++;
+    if (h->pattern < HADAMARD_ORDER) {
+        return 0;
+    }
+    h->pattern = 0;
+    h->cycles++;
+
+    // correlate: y_r = c0 + a sum_j H[r][j+1] k_j, so k_j = sum_r H[r][j+1] y_r / (N a)
+    double common = 0;
+    for (int r = 0; r < HADAMARD_ORDER; r++) {
+        common += h->y[r];
+    }
+    h->common = common / HADAMARD_ORDER;
+    for (int j = 0; j < h->channels; j++) {
+        double corr = 0;
+        for (int r = 0; r < HADAMARD_ORDER; r++) {
+            corr += hadamard_sign(r, j + 1) * h->y[r];
+        }
+        double k = corr / (HADAMARD_ORDER * (double)h->amplitude);
+        double d = k - h->mean[j];
+        h->mean[j] += d / h->cycles;
+        h->m2[j] += d * (k - h->mean[j]);
+    }
+    return 1;
+}
+
+double hadamard_stderr(const struct hadamard_id *h, int channel){
+    if (h->cycles < 2) {
+        return 0;
+    }
+    return sqrt(h->m2[channel] / (h->cycles - 1) / h->cycles);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file hadamard.h
+ * @brief Parallel identification of per-channel actuator influence. All
+ * channels are driven at once with the rows of a Sylvester Hadamard matrix
+ * (center +/- amplitude), and the sensor's mean response to each row is
+ * correlated with each channel's column. Columns are orthogonal, so one
+ * cycle of HADAMARD_ORDER patterns separates every channel's coefficient;
+ * repeated cycles give a standard error per channel. Odd cycles apply the
+ * rows in reverse, which cancels a linear baseline drift over each pair.
+ * @note Column 0 (all +1) is left to the common-mode response, channel j
+ * uses column j + 1, so up to HADAMARD_ORDER - 1 channels fit.
+ */
+
+#ifndef INC_HADAMARD_H_
+#define INC_HADAMARD_H_
+
+#include <stdint.h>
+
+#define HADAMARD_ORDER 32          // smallest Sylvester order above 26 channels + common mode
+#define HADAMARD_MAX_CHANNELS (HADAMARD_ORDER - 1)
+#define HADAMARD_SETTLE_US 100000  // actuator settling after each pattern
+
+struct hadamard_id {
+    int channels;
+    int16_t center;
+    int16_t amplitude;
+    int pattern;                   // position in the cycle
+    int cycles;                    // completed cycles
+    double y[HADAMARD_ORDER];      // mean response of each row in this cycle
+    double mean[HADAMARD_MAX_CHANNELS]; // coefficient, codes per command unit
+    double m2[HADAMARD_MAX_CHANNELS];   // Welford spread of the per-cycle estimates
+    double common;                 // mean code over the last cycle
+};
+
+/**
+ * @brief +1 or -1 entry of the Sylvester Hadamard matrix
+ */
+int hadamard_sign(int row, int col);
+
+/**
+ * @brief Start an identification
+ * @param channels channels driven, at most HADAMARD_MAX_CHANNELS
+ * @param center command every channel is perturbed around
+ * @param amplitude perturbation in command units
+ * @return 0 on success, -1 on too many channels or center +/- amplitude out of the int16_t range
+ */
+int hadamard_id_init(struct hadamard_id *h, int channels, int16_t center, int16_t amplitude);
+
+/**
+ * @brief Command values of the current pattern
+ * @param values filled with one command per channel
+ */
+void hadamard_pattern(const struct hadamard_id *h, int16_t *values);
+
+/**
+ * @brief Record the mean response to the current pattern and move to the next
+ * @return 1 when this completed a cycle and the estimates were updated
+ */
+int hadamard_id_add(struct hadamard_id *h, double y);
+
+/**
+ * @brief Standard error of a channel's coefficient, 0 before two cycles
+ */
+double hadamard_stderr(const struct hadamard_id *h, int channel);
+
+#endif /* INC_HADAMARD_H_ */
@@ -0,0 +1,159 @@
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include "hot_config.h"
+
+static char config_path[256];
+static pthread_t loader;
+static sigset_t hup;
+static sigset_t saved_mask;         // caller's mask before SIGHUP was blocked
+static atomic_int stopping;
+
+static _Atomic(struct live_config *) published;
+static atomic_ulong reader_epoch;    // bumped by every hot_config_poll()
+static atomic_ulong reader_gen;      // version the reader is using
+
+// loader thread only
+static struct live_config *retired = NULL;
+static unsigned long next_gen = 1;
+
+// reader thread only
+static struct live_config *in_use = NULL;
+
+/**
+ * @brief Free retired versions the reader can no longer be looking at
+ */
+static void reclaim(void){
+    unsigned long epoch = atomic_load(&reader_epoch);
+    unsigned long gen = atomic_load(&reader_gen);
+    struct live_config **pp = &retired;
+    while (*pp != NULL) {
+        struct live_config *c = *pp;
+        if (epoch > c->retired_epoch && c->gen != gen) {
+            *pp = c->next;
+            free(c);
+        } else {
+            pp = &c->next;
+        }
+    }
+}
+
+static void reload(void){
+    char why[80];
+    struct live_config *cur = atomic_load(&published);
+    struct live_config *c = malloc(sizeof(*c));
+    if (c == NULL) {
+        syslog(LOG_ERR, "Config reload: out of memory");
+        return;
+    }
+    // keys missing from the file keep their live values
+    c->cfg = cur->cfg;
+    if (rig_config_load_strict(config_path, &c->cfg) == -1) {
+        if (errno == EINVAL) {
+            syslog(LOG_ERR, "Config reload rejected: errors in %s", config_path);
+        } else {
+            syslog(LOG_ERR, "Config reload: cannot read %s: %s", config_path, strerror(errno));
+        }
+        free(c);
+        return;
+    }
+    if (rig_config_validate(&c->cfg, why, sizeof(why)) == -1) {
+        syslog(LOG_ERR, "Config reload rejected: %s", why);
+        free(c);
+        return;
+    }
+    c->gen = next_gen++;
+    c->next = NULL;
+    atomic_store(&published, c);
+    cur->retired_epoch = atomic_load(&reader_epoch);
+    cur->next = retired;
+    retired = cur;
+    syslog(LOG_INFO, "Config version %lu published from %s", c->gen, config_path);
+}
+
+static void *load_loop(void *arg){
+    int sig;
+    (void)arg;
+    while (!atomic_load(&stopping)) {
+        // SIGHUP is blocked in every thread, so it is only ever taken here and
+        // never interrupts a sleep of the sampling thread
+        if (sigwait(&hup, &sig) != 0) {
+            continue;
+        }
+        if (atomic_load(&stopping)) {
+            break;
+        }
+        reclaim();
+        reload();
+    }
+    return NULL;
+}
+
+void hot_config_block_signal(void){
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+}
+
+int hot_config_start(const char *path, const struct rig_config *initial){
+    struct live_config *c = calloc(1, sizeof(*c));
+    if (c == NULL) {
+        return -1;
+    }
+    c->cfg = *initial;
+    strncpy(config_path, path, sizeof(config_path) - 1);
+    atomic_store(&published, c);
+    atomic_store(&reader_gen, 0);
+    atomic_store(&stopping, 0);
+    in_use = c;
+    // normally blocked already by hot_config_block_signal(); the loader inherits the mask
+    sigemptyset(&hup);
+    sigaddset(&hup, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &hup, &saved_mask);
+    if (pthread_create(&loader, NULL, load_loop, NULL) != 0) {
+        syslog(LOG_ERR, "Config reload: cannot start loader");
+        pthread_sigmask(SIG_SETMASK, &saved_mask, NULL);
+        free(c);
+        in_use = NULL;
+        return -1;
+    }
+    syslog(LOG_INFO, "Config reload armed: kill -HUP %d reloads %s", (int)getpid(), config_path);
+    return 0;
+}
+
+const struct live_config *hot_config_poll(void){
+    struct live_config *c = atomic_load(&published);
+    const struct live_config *changed = NULL;
+    if (c != in_use) {
+        in_use = c;
+        atomic_store(&reader_gen, c->gen);
+        changed = c;
+    }
+    atomic_fetch_add(&reader_epoch, 1);
+    return changed;
+}
+
+void hot_config_request(void){
+    pthread_kill(loader, SIGHUP);
+}
+
+void hot_config_stop(void){
+    atomic_store(&stopping, 1);
+    pthread_kill(loader, SIGHUP);
+    pthread_join(loader, NULL);
+    pthread_sigmask(SIG_SETMASK, &saved_mask, NULL);
+    while (retired != NULL) {
+        struct live_config *c = retired;
+        retired = c->next;
+        free(c);
+    }
+    free(atomic_load(&published));
+    atomic_store(&published, NULL);
+    in_use = NULL;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file hot_config.h
+ * @brief Mid-run reload of the rig configuration. SIGHUP wakes a loader
+ * thread that reads and validates the file off the sampling path, then
+ * publishes the new version with a single atomic pointer store. The
+ * sampling thread picks it up between conversions with hot_config_poll().
+ * Superseded versions are freed once the sampling thread has passed a
+ * quiescent point (a poll) after they were replaced, so it never holds a
+ * freed pointer and never blocks on a lock.
+ * @note One sampling thread (reader) per process.
+ */
+
+#ifndef INC_HOT_CONFIG_H_
+#define INC_HOT_CONFIG_H_
+
+#include "rig_config.h"
+
+struct live_config {
+    unsigned long gen;            // 0 for the configuration the run started with
+    struct rig_config cfg;
+    unsigned long retired_epoch;  // reader epoch when it was replaced
+    struct live_config *next;     // retired list
+};
+
+/**
+ * @brief Block SIGHUP in the calling thread
+ * @note Call it in main() before any thread is created, so every thread
+ * inherits the mask and the loader is the only one to take the signal;
+ * SIGHUP left unblocked anywhere keeps its default action and ends the run.
+ */
+void hot_config_block_signal(void);
+
+/**
+ * @brief Publish the starting configuration and start the loader
+ * @note Blocks SIGHUP in the calling thread too, see hot_config_block_signal().
+ * @param path file read on every SIGHUP, over a copy of the live version
+ * @param initial configuration the run starts with
+ * @return 0 on success, -1 on failure
+ */
+int hot_config_start(const char *path, const struct rig_config *initial);
+
+/**
+ * @brief Quiescent point of the sampling thread; call between conversions
+ * @return the newly published configuration, or NULL if unchanged
+ * @note The returned pointer stays valid until the next version is returned.
+ */
+const struct live_config *hot_config_poll(void);
+
+/**
+ * @brief Ask for a reload, as SIGHUP does
+ */
+void hot_config_request(void);
+
+/**
+ * @brief Stop the loader, free every version and restore the signal mask
+ * hot_config_start() found
+ */
+void hot_config_stop(void);
+
+#endif /* INC_HOT_CONFIG_H_ */
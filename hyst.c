@@ -0,0 +1,235 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+#include "hyst.h"
+#include "rig_config.h"
+
+#define LANES 8 // partial sums kept apart so the dot product vectorises without reassociation
+
+/**
+ * @brief Move every play operator to the input: z = max(x - r, min(x + r, z))
+ */
+static void play(const float *restrict r, float *restrict z, float x){
+    for (int i = 0; i < HYST_OPERATORS; i++) {
+        float hi = x + r[i];
+        float lo = x - r[i];
+        float zi = z[i] < hi ? z[i] : hi;
+        z[i] = zi > lo ? zi : lo;
+    }
+}
+
+static float dot(const float *restrict a, const float *restrict z){
+    float acc[LANES] = {0};
+    for (int i = 0; i < HYST_OPERATORS; i += LANES) {
+        for (int j = 0; j < LANES; j++) {
+            acc[j] += a[i + j] * z[i + j];
+        }
+    }
+    float sum = 0;
+    for (int j = 0; j < LANES; j++) {
+        sum += acc[j];
+    }
+    return sum;
+}
+
+/**
+ * @brief Thresholds and weights of the inverse operator from the model's
+ */
+static void set_inverse(struct hyst *h){
+    double s_prev = 0, s = 0;
+    for (int j = 0; j < HYST_OPERATORS; j++) {
+        s += h->a[j];
+        double rj = 0;
+        for (int i = 0; i <= j; i++) {
+            rj += h->a[i] * (h->r[j] - h->r[i]);
+        }
+        h->ri[j] = rj;
+        h->b[j] = j == 0 ? 1 / h->a[0] : -h->a[j] / (s * s_prev);
+        s_prev = s;
+    }
+}
+
+void hyst_reset(struct hyst *h, double x0){
+    for (int i = 0; i < HYST_OPERATORS; i++) {
+        h->z[i] = h->zi[i] = h->zf[i] = x0;
+    }
+}
+
+void hyst_init(struct hyst *h, double span, double x0){
+    memset(h, 0, sizeof(*h));
+    h->span = fabs(span);
+    for (int i = 0; i < HYST_OPERATORS; i++) {
+        h->r[i] = i * h->span / (2 * HYST_OPERATORS);
+    }
+    h->a[0] = 1;
+    h->gain = 1;
+    set_inverse(h);
+    hyst_reset(h, x0);
+}
+
+double hyst_model(struct hyst *h, double x){
+    play(h->r, h->z, x);
+    return dot(h->a, h->z);
+}
+
+double hyst_inverse(struct hyst *h, double v){
+    play(h->ri, h->zi, v);
+    return dot(h->b, h->zi);
+}
+
+void hyst_fit_add(struct hyst *h, double x, double y){
+    double phi[HYST_OPERATORS + 1];
+
+    play(h->r, h->zf, x);
+    for (int i = 0; i < HYST_OPERATORS; i++) {
+        phi[i] = h->zf[i];
+    }
+    phi[HYST_OPERATORS] = 1;
+    for (int i = 0; i <= HYST_OPERATORS; i++) {
+        for (int j = 0; j <= HYST_OPERATORS; j++) {
+            h->ata[i][j] += phi[i] * phi[j];
+        }
+        h->atb[i] += phi[i] * y;
+    }
+    h->yy += y * y;
+    h->n++;
+}
+
+/**
+ * @brief Mean squared residual of weights w (operators, then the constant)
+ */
+static double mean_square(const struct hyst *h, const double *w){
+    double rss = h->yy;
+    for (int i = 0; i <= HYST_OPERATORS; i++) {
+        rss -= 2 * w[i] * h->atb[i];
+        for (int j = 0; j <= HYST_OPERATORS; j++) {
+            rss += w[i] * h->ata[i][j] * w[j];
+        }
+    }
+    return rss > 0 ? rss / h->n : 0;
+}
+
+int hyst_fit(struct hyst *h){
+    const int c = HYST_OPERATORS; // index of the constant
+    double w[HYST_OPERATORS + 1] = {0};
+
+    if (h->n <= HYST_OPERATORS) {
+        syslog(LOG_ERR, "Hysteresis fit needs more than %d points, got %ld", HYST_OPERATORS, h->n);
+        return -1;
+    }
+    // straight line first: operator 0 has threshold 0 and is the command itself
+    double det = h->ata[0][0] * h->ata[c][c] - h->ata[0][c] * h->ata[0][c];
+    if (det <= 0) {
+        syslog(LOG_ERR, "Hysteresis fit needs more than one command");
+        return -1;
+    }
+    w[0] = (h->atb[0] * h->ata[c][c] - h->atb[c] * h->ata[0][c]) / det;
+    w[c] = (h->ata[0][0] * h->atb[c] - h->ata[0][c] * h->atb[0]) / det;
+    h->rms_linear = sqrt(mean_square(h, w));
+    double sign = w[0] < 0 ? -1 : 1;
+
+    // least squares with every operator weight of the line's sign, by coordinate descent
+    for (int sweep = 0; sweep < HYST_FIT_SWEEPS; sweep++) {
+        for (int j = 0; j <= c; j++) {
+            if (h->ata[j][j] <= 0) {
+                continue;
+            }
+            double g = h->atb[j];
+            for (int k = 0; k <= c; k++) {
+                g -= h->ata[j][k] * w[k];
+            }
+            double wj = w[j] + g / h->ata[j][j];
+            w[j] = j < c && wj * sign < 0 ? 0 : wj;
+        }
+    }
+
+    double gain = 0;
+    for (int i = 0; i < c; i++) {
+        gain += w[i];
+    }
+    if (gain == 0) {
+        syslog(LOG_ERR, "Hysteresis fit found no response to the command");
+        return -1;
+    }
+    double rest = 1 - w[0] / gain;
+    for (int i = 0; i < c; i++) {
+        h->a[i] = w[i] / gain;
+    }
+    if (h->a[0] < HYST_A0_MIN) {
+        // the inverse divides by a_0; give it the floor and scale the others down
+        for (int i = 1; i < c; i++) {
+            h->a[i] *= rest > 0 ? (1 - HYST_A0_MIN) / rest : 0;
+        }
+        h->a[0] = HYST_A0_MIN;
+        for (int i = 0; i < c; i++) {
+            w[i] = gain * h->a[i];
+        }
+    }
+    h->gain = gain;
+    h->offset = w[c];
+    h->rms = sqrt(mean_square(h, w));
+    set_inverse(h);
+    return 0;
+}
+
+int hyst_load(struct hyst *h, const char *path, double x0){
+    int operators;
+    double span, gain, offset, rms, rms_linear;
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        syslog(LOG_ERR, "Failed to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    if (fscanf(f, "# hyst operators=%d span=%lf gain=%lf offset=%lf rms=%lf rms_linear=%lf",
+               &operators, &span, &gain, &offset, &rms, &rms_linear) != 6 || operators != HYST_OPERATORS) {
+        syslog(LOG_ERR, "%s is not a model of %d operators", path, HYST_OPERATORS);
+        fclose(f);
+        return -1;
+    }
+    hyst_init(h, span, x0);
+    for (int i = 0; i < HYST_OPERATORS; i++) {
+        if (fscanf(f, "%f %f", &h->r[i], &h->a[i]) != 2) {
+            syslog(LOG_ERR, "%s is truncated", path);
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    if (h->a[0] <= 0) {
+        syslog(LOG_ERR, "%s has no threshold-0 operator, it cannot be inverted", path);
+        return -1;
+    }
+    h->gain = gain;
+    h->offset = offset;
+    h->rms = rms;
+    h->rms_linear = rms_linear;
+    set_inverse(h);
+    hyst_reset(h, x0);
+    return 0;
+}
+
+int hyst_save(const struct hyst *h, const char *path){
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        syslog(LOG_ERR, "Failed to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    fprintf(f, "# hyst operators=%d span=%.3f gain=%.6f offset=%.3f rms=%.3f rms_linear=%.3f\n",
+            HYST_OPERATORS, h->span, h->gain, h->offset, h->rms, h->rms_linear);
+    for (int i = 0; i < HYST_OPERATORS; i++) {
+        fprintf(f, "%.6f %.6f\n", h->r[i], h->a[i]);
+    }
+    if (fclose(f) != 0) {
+        syslog(LOG_ERR, "Failed to write %s: %s", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int hyst_path(char *buf, size_t len, const char *rig){
+    int n = snprintf(buf, len, "%s/%s.hyst", RIG_CONFIG_DIR, rig != NULL && rig[0] != '\0' ? rig : RIG_DEFAULT);
+    return n < 0 || (size_t)n >= len ? -1 : 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file hyst.h
+ * @brief Prandtl-Ishlinskii model of the actuator hysteresis and its inverse.
+ * The model is a weighted sum of play operators of increasing threshold on
+ * the command,
+ *   code = offset + gain * H(x),  H(x) = sum a_i play_{r_i}(x),  sum a_i = 1
+ * so H is in command units and follows x with slope 1 away from reversals.
+ * The weights are fitted by least squares, with every a_i >= 0, to the
+ * (command, code) pairs of bidirectional sweeps. The inverse of a PI
+ * operator with a_0 > 0 is again a PI operator (Kuhnen), so the command
+ * that puts the actuator at position v on the hysteresis-free line is
+ * H^-1(v), evaluated as cheaply as the model.
+ * @note Operator thresholds, weights and states are kept as separate
+ * arrays of HYST_OPERATORS floats, and hyst.o is built with vectorisation
+ * on, so one evaluation updates all operators a few lanes at a time.
+ */
+
+#ifndef INC_HYST_H_
+#define INC_HYST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HYST_OPERATORS 16   // play operators, a multiple of the vector width
+#define HYST_A0_MIN 0.05    // smallest share of the threshold-0 operator, keeps the inverse bounded
+#define HYST_FIT_SWEEPS 500 // coordinate descent passes of the constrained fit
+#define HYST_FIT_CYCLES 3   // up/down sweeps of an identification run
+
+struct hyst {
+    // model: threshold, weight and state of each operator
+    float r[HYST_OPERATORS] __attribute__((aligned(32)));
+    float a[HYST_OPERATORS] __attribute__((aligned(32)));
+    float z[HYST_OPERATORS] __attribute__((aligned(32)));
+    // inverse
+    float ri[HYST_OPERATORS] __attribute__((aligned(32)));
+    float b[HYST_OPERATORS] __attribute__((aligned(32)));
+    float zi[HYST_OPERATORS] __attribute__((aligned(32)));
+    double span;            // command range the thresholds cover
+    double gain;            // codes per command unit
+    double offset;          // codes
+    // fit: normal equations of the operator outputs and a constant
+    float zf[HYST_OPERATORS] __attribute__((aligned(32)));
+    double ata[HYST_OPERATORS + 1][HYST_OPERATORS + 1];
+    double atb[HYST_OPERATORS + 1];
+    double yy;
+    long n;
+    double rms;             // residual of the fit, codes
+    double rms_linear;      // residual of a straight line through the same data
+};
+
+/**
+ * @brief Identity model with thresholds spread over half the command range
+ * @param span command range of the sweeps, the largest reversal expected
+ * @param x0 command the actuator is settled at
+ */
+void hyst_init(struct hyst *h, double span, double x0);
+
+/**
+ * @brief Set every operator as if settled at x0, for the model and the inverse
+ */
+void hyst_reset(struct hyst *h, double x0);
+
+/**
+ * @brief Advance the model with the command sent
+ * @return H(x), the position in command units
+ */
+double hyst_model(struct hyst *h, double x);
+
+/**
+ * @brief Advance the inverse with a wanted position
+ * @param v position on the hysteresis-free line, command units
+ * @return command to send
+ */
+double hyst_inverse(struct hyst *h, double v);
+
+/**
+ * @brief Add a settled (command, code) pair of a sweep to the fit, in the
+ * order the commands were sent
+ */
+void hyst_fit_add(struct hyst *h, double x, double y);
+
+/**
+ * @brief Fit the weights, gain and offset to the pairs added and set up the inverse
+ * @return 0 on success, -1 if the data cannot identify the model
+ */
+int hyst_fit(struct hyst *h);
+
+/**
+ * @brief Load a saved model, states reset to x0
+ * @return 0 on success, -1 on failure
+ */
+int hyst_load(struct hyst *h, const char *path, double x0);
+
+/**
+ * @brief Save the model
+ * @return 0 on success, -1 on failure
+ */
+int hyst_save(const struct hyst *h, const char *path);
+
+/**
+ * @brief Model file of a rig, ./testing/rigs/<rig>.hyst
+ * @return 0 on success, -1 if the path does not fit
+ */
+int hyst_path(char *buf, size_t len, const char *rig);
+
+#endif /* INC_HYST_H_ */
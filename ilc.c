@@ -0,0 +1,156 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include "ilc.h"
+#include "rig_config.h"
+
+int ilc_init(struct ilc *il, int steps, int per_step, double learn, double plant_gain){
+    memset(il, 0, sizeof(*il));
+    if (steps < 1 || per_step < 1 || plant_gain == 0) {
+        return -1;
+    }
+    il->steps = steps;
+    il->per_step = per_step;
+    il->n = steps * per_step;
+    il->learn = learn;
+    il->plant_gain = plant_gain;
+    il->u = calloc(il->n, sizeof(double));
+    il->e = calloc(il->n, sizeof(double));
+    il->tmp = calloc(il->n, sizeof(double));
+    il->ref = calloc(steps, sizeof(double));
+    if (il->u == NULL || il->e == NULL || il->tmp == NULL || il->ref == NULL) {
+        syslog(LOG_ERR, "Failed to allocate the ILC table for %d x %d samples", steps, per_step);
+        ilc_free(il);
+        return -1;
+    }
+    for (int k = 0; k < il->n; k++) {
+        il->e[k] = NAN;
+    }
+    return 0;
+}
+
+void ilc_set_reference(struct ilc *il, double y0, int16_t cmd_inc){
+    for (int k = 0; k < il->steps; k++) {
+        il->ref[k] = y0 + il->plant_gain * cmd_inc * k;
+    }
+}
+
+double ilc_command(const struct ilc *il, int k, int i){
+    return il->u[k * il->per_step + i];
+}
+
+void ilc_record(struct ilc *il, int k, int i, uint32_t code){
+    il->e[k * il->per_step + i] = il->ref[k] - code;
+}
+
+/**
+ * @brief One pass of the symmetric [1/4 1/2 1/4] smoother, ends reflected
+ */
+static void smooth(double *x, double *tmp, int n){
+    if (n < 3) {
+        return;
+    }
+    tmp[0] = 0.75 * x[0] + 0.25 * x[1];
+    for (int k = 1; k < n - 1; k++) {
+        tmp[k] = 0.25 * x[k - 1] + 0.5 * x[k] + 0.25 * x[k + 1];
+    }
+    tmp[n - 1] = 0.25 * x[n - 2] + 0.75 * x[n - 1];
+    memcpy(x, tmp, n * sizeof(double));
+}
+
+void ilc_update(struct ilc *il, double limit){
+    double sum = 0;
+    int m = 0;
+
+    il->max = 0;
+    for (int k = 0; k < il->n; k++) {
+        if (isnan(il->e[k])) {
+            continue;
+        }
+        sum += il->e[k] * il->e[k];
+        m++;
+        if (fabs(il->e[k]) > il->max) {
+            il->max = fabs(il->e[k]);
+        }
+    }
+    il->rms = m > 0 ? sqrt(sum / m) : 0;
+
+    // the command at k shows from sample k + 1 on; the last sample has no successor
+    double l = il->learn / il->plant_gain;
+    for (int k = 0; k + 1 < il->n; k++) {
+        if (!isnan(il->e[k + 1])) {
+            il->u[k] += l * il->e[k + 1];
+        }
+    }
+    for (int p = 0; p < ILC_Q_PASSES; p++) {
+        smooth(il->u, il->tmp, il->n);
+    }
+    for (int k = 0; k < il->n; k++) {
+        if (il->u[k] > limit) {
+            il->u[k] = limit;
+        } else if (il->u[k] < -limit) {
+            il->u[k] = -limit;
+        }
+        il->e[k] = NAN;
+    }
+    il->reps++;
+}
+
+int ilc_load(struct ilc *il, const char *path){
+    int steps, per_step, reps;
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    if (fscanf(f, "# ilc steps=%d per_step=%d reps=%d", &steps, &per_step, &reps) != 3 ||
+        steps != il->steps || per_step != il->per_step) {
+        syslog(LOG_WARNING, "%s was learned for another plan, starting from zero", path);
+        fclose(f);
+        return -1;
+    }
+    for (int k = 0; k < il->n; k++) {
+        if (fscanf(f, "%lf", &il->tmp[k]) != 1) {
+            syslog(LOG_WARNING, "%s is truncated, starting from zero", path);
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    memcpy(il->u, il->tmp, il->n * sizeof(double));
+    il->reps = reps;
+    return 0;
+}
+
+int ilc_save(const struct ilc *il, const char *path){
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        syslog(LOG_ERR, "Failed to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    fprintf(f, "# ilc steps=%d per_step=%d reps=%d\n", il->steps, il->per_step, il->reps);
+    for (int k = 0; k < il->n; k++) {
+        fprintf(f, "%.4f\n", il->u[k]);
+    }
+    if (fclose(f) != 0) {
+        syslog(LOG_ERR, "Failed to write %s: %s", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int ilc_path(char *buf, size_t len, const char *rig){
+    int n = snprintf(buf, len, "%s/%s.ilc", RIG_CONFIG_DIR, rig != NULL && rig[0] != '\0' ? rig : RIG_DEFAULT);
+    return n < 0 || (size_t)n >= len ? -1 : 0;
+}
+
+void ilc_free(struct ilc *il){
+    free(il->u);
+    free(il->e);
+    free(il->tmp);
+    free(il->ref);
+    il->u = il->e = il->tmp = il->ref = NULL;
+}
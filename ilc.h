@@ -0,0 +1,93 @@
+/**
+ * @file ilc.h
+ * @brief Iterative learning control over repetitions of the same sweep plan.
+ * The feedforward table holds one command offset per sample of the plan
+ * (steps x samples per step). After each repetition the tracking error
+ * against the reference is folded in, one sample ahead since a command can
+ * only move later samples:
+ *   u[k] <- Q(u[k] + learn / plant_gain * e[k + 1])
+ * with Q a zero-phase [1/4 1/2 1/4] smoother along the plan that keeps
+ * sample noise from being learned. The reference is the ideal staircase:
+ * each step lands at plant_gain * cmd_inc codes from the baseline.
+ * @note The table is saved next to the rig configuration and picked up by
+ * the next run of the same plan.
+ */
+
+#ifndef INC_ILC_H_
+#define INC_ILC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ILC_LEARN_DEFAULT 0.5  // share of the error corrected per repetition
+#define ILC_Q_PASSES 1         // smoother passes per update, 0 = no filtering
+
+struct ilc {
+    int steps;
+    int per_step;           // samples per step
+    int n;                  // steps * per_step
+    double learn;           // learning gain, 0 < learn <= 1 for a monotone decrease
+    double plant_gain;      // codes per command unit
+    double *u;              // feedforward, command units
+    double *e;              // this repetition's error, codes, NAN where no sample was read
+    double *ref;            // reference code per step
+    double *tmp;
+    int reps;               // completed repetitions
+    double rms;             // error norms of the last repetition, codes
+    double max;
+};
+
+/**
+ * @brief Allocate a zero feedforward table
+ * @param steps steps of the plan
+ * @param per_step samples per step
+ * @param learn learning gain
+ * @param plant_gain codes per command unit, from auto-tune
+ * @return 0 on success, -1 on failure
+ */
+int ilc_init(struct ilc *il, int steps, int per_step, double learn, double plant_gain);
+
+/**
+ * @brief Set the reference of every step from the baseline code of this repetition
+ * @param y0 code at the plan's start command
+ * @param cmd_inc command increment between steps
+ */
+void ilc_set_reference(struct ilc *il, double y0, int16_t cmd_inc);
+
+/**
+ * @brief Feedforward command offset of sample i of step k
+ */
+double ilc_command(const struct ilc *il, int k, int i);
+
+/**
+ * @brief Record the code read at sample i of step k
+ */
+void ilc_record(struct ilc *il, int k, int i, uint32_t code);
+
+/**
+ * @brief End a repetition: compute its error norms and learn the next table
+ * @param limit largest feedforward offset magnitude
+ */
+void ilc_update(struct ilc *il, double limit);
+
+/**
+ * @brief Load a saved table
+ * @return 0 when loaded, -1 if missing or made for another plan (table unchanged)
+ */
+int ilc_load(struct ilc *il, const char *path);
+
+/**
+ * @brief Save the table
+ * @return 0 on success, -1 on failure
+ */
+int ilc_save(const struct ilc *il, const char *path);
+
+/**
+ * @brief Table file of a rig, ./testing/rigs/<rig>.ilc
+ * @return 0 on success, -1 if the path does not fit
+ */
+int ilc_path(char *buf, size_t len, const char *rig);
+
+void ilc_free(struct ilc *il);
+
+#endif /* INC_ILC_H_ */
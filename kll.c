@@ -0,0 +1,287 @@
+#include <stdlib.h>
+#include <string.h>
+#include "kll.h"
+
+static int level_size(const struct kll_sketch *s, int h){
+    return s->levels[h + 1] - s->levels[h];
+}
+
+/**
+ * @brief Capacity of level h: KLL_K at the top, shrinking by 2/3 per level down
+ */
+static int level_capacity(int num_levels, int h){
+    int depth = num_levels - 1 - h;
+    double cap = KLL_K;
+    for (int d = 0; d < depth && cap >= 2; d++) {
+        cap *= 2.0 / 3.0;
+    }
+    return cap < 2 ? 2 : (int)cap;
+}
+
+static int cmp_u32(const void *a, const void *b){
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t coin(struct kll_sketch *s){
+    s->rng ^= s->rng << 13;
+    s->rng ^= s->rng >> 17;
+    s->rng ^= s->rng << 5;
+    return s->rng & 1;
+}
+
+void kll_init(struct kll_sketch *s){
+    memset(s, 0, sizeof(*s));
+    s->min = UINT32_MAX;
+    s->rng = 0x2545F491u;
+    s->num_levels = 1;
+    s->levels[0] = KLL_CAPACITY;
+    s->levels[1] = KLL_CAPACITY;
+}
+
+/**
+ * @brief Halve the lowest over-full level into the one above it
+ */
+static void compress(struct kll_sketch *s){
+    static __thread uint32_t merged[KLL_CAPACITY];
+    int h = 0;
+    while (h < s->num_levels - 1 && level_size(s, h) < level_capacity(s->num_levels, h)) {
+        h++;
+    }
+    if (h == s->num_levels - 1 && s->num_levels < KLL_MAX_LEVELS) {
+        // grow a new, empty top level above the current one
+        s->levels[s->num_levels + 1] = KLL_CAPACITY;
+        s->num_levels++;
+    }
+    if (h + 1 >= s->num_levels) {
+        return; // at the level limit; callers stop accepting input long before
+    }
+
+    uint32_t *lo = &s->items[s->levels[h]];
+    uint32_t *hi = &s->items[s->levels[h + 1]];
+    int a = level_size(s, h);
+    int b = level_size(s, h + 1);
+    if (h == 0) {
+        qsort(lo, a, sizeof(*lo), cmp_u32); // higher levels are kept sorted
+    }
+
+    // an odd item stays behind at level h; every other item of the rest moves up
+    int odd = a & 1;
+    int offset = coin(s);
+    int half = (a - odd) / 2;
+    int i = odd + offset, j = 0, k = 0;
+    while (i < a || j < b) {
+        if (j >= b || (i < a && lo[i] <= hi[j])) {
+            merged[k++] = lo[i];
+            i += 2;
+        } else {
+            merged[k++] = hi[j++];
+        }
+    }
+
+    // new layout: levels below h shift up by the freed space
+    int freed = a - odd - half;
+    uint16_t top = s->levels[h + 2];
+    memcpy(&s->items[top - k], merged, k * sizeof(*merged));
+    s->levels[h + 1] = top - k;
+    if (odd) {
+        s->items[top - k - 1] = lo[0];
+    }
+    s->levels[h] = top - k - odd;
+    if (h > 0) {
+        memmove(&s->items[s->levels[0] + freed], &s->items[s->levels[0]],
+                (s->levels[h] - freed - s->levels[0]) * sizeof(*s->items));
+        for (int l = 0; l < h; l++) {
+            s->levels[l] += freed;
+        }
+    }
+}
+
+void kll_update(struct kll_sketch *s, uint32_t value){
+    if (value < s->min) {
+        s->min = value;
+    }
+    if (value > s->max) {
+        s->max = value;
+    }
+    if (s->levels[0] == 0) {
+        compress(s);
+    }
+    s->items[--s->levels[0]] = value;
+    s->n++;
+}
+
+void kll_merge(struct kll_sketch *a, const struct kll_sketch *b){
+    // feed b's items in at their own level so their weight is kept
+    for (int h = b->num_levels - 1; h >= 0; h--) {
+        while (a->num_levels <= h && a->num_levels < KLL_MAX_LEVELS) {
+            a->levels[a->num_levels + 1] = KLL_CAPACITY;
+            a->num_levels++;
+        }
+        for (int i = b->levels[h]; i < b->levels[h + 1]; i++) {
+            while (a->levels[0] == 0) {
+                compress(a);
+            }
+            // insert into level h: shift levels 0..h-1 down one slot
+            uint32_t v = b->items[i];
+            int pos = a->levels[h];
+            memmove(&a->items[a->levels[0] - 1], &a->items[a->levels[0]],
+                    (pos - a->levels[0]) * sizeof(*a->items));
+            for (int l = 0; l <= h; l++) {
+                a->levels[l]--;
+            }
+            if (h > 0) { // keep the level sorted
+                int p = a->levels[h];
+                while (p + 1 < a->levels[h + 1] && a->items[p + 1] < v) {
+                    a->items[p] = a->items[p + 1];
+                    p++;
+                }
+                a->items[p] = v;
+            } else {
+                a->items[pos - 1] = v;
+            }
+        }
+    }
+    a->n += b->n;
+    if (b->min < a->min) {
+        a->min = b->min;
+    }
+    if (b->max > a->max) {
+        a->max = b->max;
+    }
+}
+
+struct weighted {
+    uint32_t value;
+    uint32_t weight;
+};
+
+static int cmp_weighted(const void *a, const void *b){
+    return cmp_u32(&((const struct weighted *)a)->value, &((const struct weighted *)b)->value);
+}
+
+uint32_t kll_quantile(const struct kll_sketch *s, double q){
+    static __thread struct weighted all[KLL_CAPACITY];
+    int count = 0;
+    uint64_t total = 0;
+
+    if (s->n == 0) {
+        return 0;
+    }
+    if (q <= 0) {
+        return s->min;
+    }
+    if (q >= 1) {
+        return s->max;
+    }
+    for (int h = 0; h < s->num_levels; h++) {
+        for (int i = s->levels[h]; i < s->levels[h + 1]; i++) {
+            all[count].value = s->items[i];
+            all[count].weight = 1u << h;
+            total += 1u << h;
+            count++;
+        }
+    }
+    qsort(all, count, sizeof(*all), cmp_weighted);
+
+    uint64_t rank = (uint64_t)(q * total);
+    uint64_t cum = 0;
+    for (int i = 0; i < count; i++) {
+        cum += all[i].weight;
+        if (cum > rank) {
+            return all[i].value;
+        }
+    }
+    return s->max;
+}
+
+void kll_write_json(FILE *f, const struct kll_sketch *s){
+    fprintf(f, "{\"k\": %d, \"n\": %llu, \"min\": %u, \"max\": %u, \"levels\": [",
+            KLL_K, (unsigned long long)s->n, s->n ? s->min : 0, s->max);
+    for (int h = 0; h < s->num_levels; h++) {
+        fprintf(f, "%s[", h ? ", " : "");
+        for (int i = s->levels[h]; i < s->levels[h + 1]; i++) {
+            fprintf(f, "%s%u", i > s->levels[h] ? "," : "", s->items[i]);
+        }
+        fprintf(f, "]");
+    }
+    fprintf(f, "]}");
+}
+
+static const char *expect(const char *p, const char *token){
+    p = strstr(p, token);
+    return p ? p + strlen(token) : NULL;
+}
+
+int kll_read_json(struct kll_sketch *s, const char *text, const char **end){
+    static __thread uint32_t level_items[KLL_MAX_LEVELS][KLL_CAPACITY];
+    int level_len[KLL_MAX_LEVELS];
+    char *e;
+    const char *p;
+
+    kll_init(s);
+    if ((p = expect(text, "\"k\": ")) == NULL || strtol(p, &e, 10) != KLL_K) {
+        return -1; // different accuracy parameter
+    }
+    if ((p = expect(e, "\"n\": ")) == NULL) {
+        return -1;
+    }
+    uint64_t n = strtoull(p, &e, 10);
+    if ((p = expect(e, "\"min\": ")) == NULL) {
+        return -1;
+    }
+    uint32_t min = strtoul(p, &e, 10);
+    if ((p = expect(e, "\"max\": ")) == NULL) {
+        return -1;
+    }
+    uint32_t max = strtoul(p, &e, 10);
+    if ((p = expect(e, "\"levels\": [")) == NULL) {
+        return -1;
+    }
+
+    int num_levels = 0, total = 0;
+    while (*p == '[' || *p == ',' || *p == ' ') {
+        if (*p != '[') {
+            p++;
+            continue;
+        }
+        if (num_levels == KLL_MAX_LEVELS) {
+            return -1;
+        }
+        p++;
+        level_len[num_levels] = 0;
+        while (*p != ']') {
+            if (total == KLL_CAPACITY) {
+                return -1;
+            }
+            level_items[num_levels][level_len[num_levels]++] = strtoul(p, &e, 10);
+            total++;
+            if (e == p) {
+                return -1;
+            }
+            p = (*e == ',') ? e + 1 : e;
+        }
+        p++;
+        num_levels++;
+    }
+    if (*p != ']' || num_levels == 0) {
+        return -1;
+    }
+
+    // lay the levels out top down, as compress() keeps them
+    s->num_levels = num_levels;
+    int top = KLL_CAPACITY;
+    s->levels[num_levels] = top;
+    for (int h = num_levels - 1; h >= 0; h--) {
+        top -= level_len[h];
+        memcpy(&s->items[top], level_items[h], level_len[h] * sizeof(uint32_t));
+        s->levels[h] = top;
+    }
+    s->n = n;
+    s->min = n ? min : UINT32_MAX;
+    s->max = max;
+    if (end != NULL) {
+        *end = p + 1;
+    }
+    return 0;
+}
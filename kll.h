@@ -0,0 +1,57 @@
+/**
+ * @file kll.h
+ * @brief KLL quantile sketch of 32 bit LHR codes in fixed memory. Sketches
+ * are mergeable, so per-step sketches from different runs can be combined
+ * into one tail estimate without any raw samples.
+ */
+
+#ifndef INC_KLL_H_
+#define INC_KLL_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define KLL_K 200          // accuracy parameter, about 1.3% rank error
+#define KLL_MAX_LEVELS 24  // enough for 2^24 * KLL_K samples per sketch
+#define KLL_CAPACITY (3 * KLL_K + 2 * KLL_MAX_LEVELS) // bound on the sum of level capacities
+
+struct kll_sketch {
+    uint64_t n;            // samples represented
+    uint32_t min;
+    uint32_t max;
+    uint32_t rng;          // compaction coin state
+    int num_levels;
+    // level h holds items[levels[h] .. levels[h+1]-1], each weighing 2^h;
+    // level 0 grows downwards into the free space at the bottom of items
+    uint16_t levels[KLL_MAX_LEVELS + 1];
+    uint32_t items[KLL_CAPACITY];
+};
+
+void kll_init(struct kll_sketch *s);
+
+void kll_update(struct kll_sketch *s, uint32_t value);
+
+/**
+ * @brief Fold sketch b into a
+ */
+void kll_merge(struct kll_sketch *a, const struct kll_sketch *b);
+
+/**
+ * @brief Estimated q quantile, 0 <= q <= 1 (min/max are exact)
+ */
+uint32_t kll_quantile(const struct kll_sketch *s, double q);
+
+/**
+ * @brief Write the sketch as a JSON object
+ */
+void kll_write_json(FILE *f, const struct kll_sketch *s);
+
+/**
+ * @brief Parse a sketch written by kll_write_json()
+ * @param text JSON text starting at (or before) the sketch's opening brace
+ * @param end set past the parsed object, may be NULL
+ * @return 0 on success, -1 on malformed input
+ */
+int kll_read_json(struct kll_sketch *s, const char *text, const char **end);
+
+#endif /* INC_KLL_H_ */
@@ -0,0 +1,277 @@
+#include <errno.h>
+#include <string.h>
+#include <syslog.h>
+#ifdef LDC1101_SPIDEV
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+#else
+#include <wiringPi.h>
+#include <wiringPiSPI.h>
+#endif
+#include "ldc1101.h"
+#include "ldc_sim.h"
+
+#define SPI_SPEED 1000000 // MHz
+#ifndef SPI_MODE_3 // spidev.h has them
+#define SPI_MODE_0 0 // SPI mode 0 (CPOL=0, CPHA=0)
+#define SPI_MODE_3 3 // SPI mode 3 (CPOL=1, CPHA=1)
+#endif
+#define HIGH_Q_SENSOR 0 << 7
+#define LOPTIMAL 0x01
+#define DOK_REPORT 0x01
+#define FUNC_MODE_ACTIVE 0x00
+#define FUNC_MODE_SLEEP 0x01
+#define WAKE_EARLY 0.75 // sleep through this much of an expected conversion
+#define MIN_SLEEP_NS 200000 // shorter waits are polled
+
+static int64_t now_ns(const struct ldc1101 *dev){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)(t.tv_sec - dev->t0.tv_sec) * 1000000000 + (t.tv_nsec - dev->t0.tv_nsec);
+}
+
+/*
+ * The bus transport is chosen when building (make TRANSPORT=spidev), not
+ * through a function pointer: spi_transfer() is static, so it inlines into
+ * every register access and the sample loop makes direct calls only.
+ */
+#ifdef LDC1101_SPIDEV
+static int spi_setup(struct ldc1101 *dev){
+    char path[32];
+    uint8_t mode = SPI_MODE_3;
+    uint8_t bits = 8;
+    uint32_t speed = SPI_SPEED;
+
+    snprintf(path, sizeof(path), "/dev/spidev%d.%d", dev->spi_num, dev->spi_chan);
+    dev->fd = open(path, O_RDWR);
+    if (dev->fd == -1 || ioctl(dev->fd, SPI_IOC_WR_MODE, &mode) == -1 ||
+        ioctl(dev->fd, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1 || ioctl(dev->fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) == -1) {
+        if (dev->fd != -1) {
+            close(dev->fd);
+        }
+        dev->fd = -1;
+    }
+    return dev->fd;
+}
+
+static int bus_transfer(struct ldc1101 *dev, uint8_t *data, int length){
+    struct spi_ioc_transfer tr;
+    memset(&tr, 0, sizeof(tr));
+    tr.tx_buf = (uintptr_t)data;
+    tr.rx_buf = (uintptr_t)data;
+    tr.len = length;
+    tr.speed_hz = SPI_SPEED;
+    tr.bits_per_word = 8;
+    return ioctl(dev->fd, SPI_IOC_MESSAGE(1), &tr);
+}
+#else
+static int spi_setup(struct ldc1101 *dev){
+    wiringPiSetup();
+    dev->fd = wiringPiSPIxSetupMode(dev->spi_num, dev->spi_chan, SPI_SPEED, SPI_MODE_3);
+    return dev->fd;
+}
+
+static int bus_transfer(struct ldc1101 *dev, uint8_t *data, int length){
+    return wiringPiSPIxDataRW(dev->spi_num, dev->spi_chan, data, length);
+}
+#endif
+
+/**
+ * @brief SPI transaction with the LDC1101, or with its model when simulated
+ * @param data transmit buffer, replaced by the received bytes
+ * @param length bytes to transfer
+ * @return bytes transferred, -1 on failure
+ */
+static inline int spi_transfer(struct ldc1101 *dev, uint8_t *data, int length){
+    if (dev->sim != NULL) {
+        return ldc_sim_spi(dev->sim, data, length);
+    }
+    return bus_transfer(dev, data, length);
+}
+
+int ldc1101_set_reg(struct ldc1101 *dev, uint8_t reg, uint8_t value){
+    uint8_t data[2] = {reg, value}; // Prepare data to write
+    int ret_val = spi_transfer(dev, data, sizeof(data));
+    if (ret_val == -1) {
+        syslog(LOG_ERR, "Failed to write to LDC1101 register %d: %s\n", reg, strerror(errno));
+        return -1;
+    }
+    return 0; // Success
+}
+
+int ldc1101_read_reg(struct ldc1101 *dev, uint8_t reg, uint8_t *data, size_t length) {
+    data[0] = 1<<7|reg; // Set register address to read
+    int ret_val = spi_transfer(dev, data, length + 1); // +1 for register address byte
+    if (ret_val == -1) {
+        syslog(LOG_ERR, "Failed to read from LDC1101 register %d: %s\n", reg, strerror(errno));
+        return -1; // Error
+    }
+    return 0;
+}
+
+int ldc1101_set_rcount(struct ldc1101 *dev, uint16_t rcount){
+    int ret = 0;
+    if (rcount == dev->rcount) {
+        return 0;
+    }
+    ret |= ldc1101_set_reg(dev, LDC1101_START_CONFIG, FUNC_MODE_SLEEP);
+    if ((rcount >> 8) != (dev->rcount >> 8)) {
+        ret |= ldc1101_set_reg(dev, LDC1101_LHR_RCOUNT_MSB, (rcount >> 8) & 0xFF);
+    }
+    if ((rcount & 0xFF) != (dev->rcount & 0xFF)) {
+        ret |= ldc1101_set_reg(dev, LDC1101_LHR_RCOUNT_LSB, rcount & 0xFF);
+    }
+    ret |= ldc1101_set_reg(dev, LDC1101_START_CONFIG, FUNC_MODE_ACTIVE);
+    dev->rcount = rcount;
+    return ret;
+}
+
+double ldc1101_conversion_time(const struct ldc1101 *dev, uint16_t rcount){
+    return (16.0 * rcount + 55) / dev->clkin_hz;
+}
+
+/**
+ * @brief Poll LHR_STATUS until a conversion is ready
+ * @param deadline_ns give up at this time since t0, < 0 for never
+ * @return 1 when ready, 0 on timeout, -1 on failure
+ */
+static int wait_ready(struct ldc1101 *dev, uint8_t *lhr_status, int64_t deadline_ns){
+    for (;;) {
+        uint8_t data[2] = {LDC1101_LHR_STATUS, 0};
+        if (ldc1101_read_reg(dev, LDC1101_LHR_STATUS, data, sizeof(data) - 1) == -1) {
+            return -1;
+        }
+        *lhr_status = data[1];
+        if ((data[1] & LDC1101_LHR_DRDY) == 0) { // data ready bit=0 if data is ready
+            return 1;
+        }
+        if (deadline_ns >= 0 && now_ns(dev) >= deadline_ns) {
+            return 0;
+        }
+    }
+}
+
+static int read_code(struct ldc1101 *dev, uint32_t *value){
+    uint8_t data[4] = {0, 0, 0, 0};
+    if (ldc1101_read_reg(dev, LDC1101_LHR_DATA_LSB, data, sizeof(data) - 1) == -1) {
+        return -1;
+    }
+    *value = (data[3] << 16) | (data[2] << 8) | data[1]; // Combine data bytes into value
+    return 0;
+}
+
+int ldc1101_read_value(struct ldc1101 *dev, uint32_t *value, uint8_t *lhr_status){
+    if (wait_ready(dev, lhr_status, -1) == -1) {
+        return -1;
+    }
+    return read_code(dev, value);
+}
+
+int ldc1101_read_samples(struct ldc1101 *dev, struct ldc1101_sample *buf, int n, int timeout_ms){
+    int64_t start = now_ns(dev);
+    int64_t deadline = timeout_ms < 0 ? -1 : start + (int64_t)timeout_ms * 1000000;
+    int64_t sleep_ns = (int64_t)(WAKE_EARLY * ldc1101_conversion_time(dev, dev->rcount) * 1e9);
+    int i = 0;
+
+    for (; i < n; i++) {
+        struct ldc1101_sample *s = &buf[i];
+        if (i > 0 && sleep_ns > MIN_SLEEP_NS) {
+            // the next conversion cannot be ready before most of its conversion time has passed
+            int64_t wake = buf[i - 1].t_ns + sleep_ns;
+            if (deadline >= 0 && wake > deadline) {
+                wake = deadline;
+            }
+            struct timespec until = dev->t0;
+            until.tv_sec += wake / 1000000000;
+            until.tv_nsec += wake % 1000000000;
+            if (until.tv_nsec >= 1000000000) {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000;
+            }
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR) {
+            }
+        }
+        int ready = wait_ready(dev, &s->status, deadline);
+        if (ready == 0) {
+            break; // timed out
+        }
+        if (ready == -1 || read_code(dev, &s->code) == -1) {
+            return i > 0 ? i : -1;
+        }
+        s->t_ns = now_ns(dev);
+    }
+    return i;
+}
+
+int ldc1101_open(struct ldc1101 *dev, int spi_num, int spi_chan, struct ldc_sim *sim, uint16_t rcount){
+    uint8_t data[2] = {0};
+    int ret_val = 0;
+
+    memset(dev, 0, sizeof(*dev));
+    dev->spi_num = spi_num;
+    dev->spi_chan = spi_chan;
+    dev->sim = sim;
+    dev->rcount = rcount;
+    dev->clkin_hz = LDC1101_CLKIN_HZ;
+    clock_gettime(CLOCK_MONOTONIC, &dev->t0);
+
+    // get the file descriptor for SPI communication
+    dev->fd = -1;
+    if (sim == NULL) {
+        spi_setup(dev);
+        syslog(LOG_INFO, "spi_fd: %d\n", dev->fd);
+        if (dev->fd == -1) {
+            syslog(LOG_ERR,"Failed to initialize SPI peripheral: %s\n", strerror(errno));
+            return -1;
+        }
+    }
+    syslog(LOG_INFO, "SPI peripheral initialized.\n");
+
+    // LDC1101 initialization
+    // Disable Rp calculation for cleaner LHR measurement
+    ret_val |= ldc1101_set_reg(dev, LDC1101_ALT_CONFIG, LOPTIMAL);
+    ret_val |= ldc1101_set_reg(dev, LDC1101_D_CONF, DOK_REPORT);
+
+    // Set RCOUNT MSB and LSB
+    ret_val |= ldc1101_set_reg(dev, LDC1101_LHR_RCOUNT_MSB, (rcount >> 8) & 0xFF);
+    ret_val |= ldc1101_set_reg(dev, LDC1101_LHR_RCOUNT_LSB, rcount & 0xFF);
+
+    // Set RP to adjust the amplitude of the oscillation
+    uint8_t rpmin = 0x07; // lower three digits
+    uint8_t rpmin_mask = 0x07;
+    uint8_t rpmax = 0x00; // upper three digits (see datasheet, Table 4 for details) )
+    uint8_t rpmax_mask = 0x70;
+    uint8_t reserved = ~(0x08); // Reserved bits set to 0
+    uint8_t rp_value = (HIGH_Q_SENSOR| ((rpmax<<4) & rpmax_mask) | (rpmin & rpmin_mask)) & reserved; // Combine RP_MAX and RP_MIN
+    ret_val |= ldc1101_set_reg(dev, LDC1101_RP_SET, rp_value);
+    if (ret_val != 0) {
+        return -1;
+    }
+
+    // Verify device ID
+    if (ldc1101_read_reg(dev, LDC1101_CHIP_ID, data, sizeof(data) - 1) == -1) {
+        syslog(LOG_ERR, "Failed to read LDC1101 device ID: %s\n", strerror(errno));
+        return -1;
+    }
+    if (data[1] != LDC1101_DEVICE_ID) { // Check if device ID matches expected value
+        syslog(LOG_ERR, "Unexpected Device ID: 0x%02X, expected: 0x%02X\n", data[1], LDC1101_DEVICE_ID);
+        return -1;
+    }
+    syslog(LOG_INFO, "LDC1101 Device ID: 0x%02X verified\n", data[1]);
+
+    // writing 0 to START_CONFIG initiates the chip conversion
+    return ldc1101_set_reg(dev, LDC1101_START_CONFIG, FUNC_MODE_ACTIVE);
+}
+
+void ldc1101_close(struct ldc1101 *dev){
+    if (dev->sim == NULL && dev->fd != -1) {
+        ldc1101_set_reg(dev, LDC1101_START_CONFIG, FUNC_MODE_SLEEP);
+#ifdef LDC1101_SPIDEV
+        close(dev->fd); // wiringPi keeps its descriptors to itself
+#endif
+    }
+    dev->fd = -1;
+}
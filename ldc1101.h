@@ -8,6 +8,10 @@
 #ifndef INC_LDC1101_H_
 #define INC_LDC1101_H_
 
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
 // Register Addresses
 #define LDC1101_RP_SET            0x01  // RP Measurement Dynamic Range
 #define LDC1101_TC1               0x02  // Time Constant 1 Register
@@ -59,6 +63,94 @@
 #define LDC1101_ERR_OF  1<<1    // Overflow error--sensor frequency is too close to reference frequency
 #define LDC1101_LHR_DRDY 1<<0   // Conversion data is ready 
 
+#define LDC1101_DEVICE_ID 0xD4
+#define LDC1101_CLKIN_HZ 16e6   // reference clock, a conversion takes (16 RCOUNT + 55) cycles
+
+struct ldc_sim;
+
+// One LHR conversion
+struct ldc1101_sample {
+    int64_t t_ns;          // when it was read, since the device's t0
+    uint32_t code;         // LHR data code
+    uint8_t status;        // LHR_STATUS seen with the data ready
+};
+
+struct ldc1101 {
+    int spi_num;
+    int spi_chan;
+    int fd;                // SPI bus descriptor, -1 when simulated
+    struct ldc_sim *sim;   // not NULL: the SPI transfers go to this model
+    uint16_t rcount;       // RCOUNT currently programmed
+    double clkin_hz;       // for the expected conversion time
+    struct timespec t0;    // CLOCK_MONOTONIC origin of the sample timestamps
+};
+
 // LDC1101 Prototypes
 
+/**
+ * @brief Set up the SPI bus, configure the LHR measurement and start conversions.
+ * The bus is driven through wiringPi, or through the kernel's spidev driver
+ * when built with LDC1101_SPIDEV (make TRANSPORT=spidev).
+ * @param dev device handle, t0 is set to now
+ * @param spi_num SPI peripheral
+ * @param spi_chan chip select
+ * @param sim sensor model to use instead of the bus, or NULL
+ * @param rcount initial LHR RCOUNT
+ * @return status: 0 on success, -1 on failure (wrong device ID included)
+ */
+int ldc1101_open(struct ldc1101 *dev, int spi_num, int spi_chan, struct ldc_sim *sim, uint16_t rcount);
+
+/**
+ * @brief Put the device to sleep and release the bus
+ */
+void ldc1101_close(struct ldc1101 *dev);
+
+/**
+ * @brief Set an LDC1101 register with a value
+ * @return status: 0 on success, -1 on failure
+ */
+int ldc1101_set_reg(struct ldc1101 *dev, uint8_t reg, uint8_t value);
+
+/**
+ * @brief Read consecutive LDC1101 registers
+ * @param reg first register address
+ * @param data receives the bytes from data[1] on, data[0] is the address byte
+ * @param length registers to read, data must hold length + 1 bytes
+ * @return status: 0 on success, -1 on failure
+ */
+int ldc1101_read_reg(struct ldc1101 *dev, uint8_t reg, uint8_t *data, size_t length);
+
+/**
+ * @brief Change the LHR reference count while running
+ * @return status: 0 on success, -1 on failure
+ * @note Only the RCOUNT bytes that differ are written. The device is put to
+ * sleep around the write so the next conversion starts with the new count.
+ */
+int ldc1101_set_rcount(struct ldc1101 *dev, uint16_t rcount);
+
+/**
+ * @brief Expected time of one LHR conversion at an RCOUNT, in seconds
+ */
+double ldc1101_conversion_time(const struct ldc1101 *dev, uint16_t rcount);
+
+/**
+ * @brief Wait for the next LHR conversion and read it
+ * @param value container for the 24 bit code
+ * @param lhr_status container for the last LHR_STATUS read
+ * @return status: 0 on success, -1 on failure
+ */
+int ldc1101_read_value(struct ldc1101 *dev, uint32_t *value, uint8_t *lhr_status);
+
+/**
+ * @brief Read up to n consecutive conversions, timestamped as they arrive
+ * @param buf caller's array of at least n samples
+ * @param n samples wanted
+ * @param timeout_ms give up waiting after this long, < 0 to wait for all n
+ * @return samples read, fewer than n on timeout or a failed transfer;
+ * -1 when the first transfer fails
+ * @note Within a call the expected conversion time is slept through before
+ * DRDY is polled, so a long RCOUNT does not keep the SPI bus busy.
+ */
+int ldc1101_read_samples(struct ldc1101 *dev, struct ldc1101_sample *buf, int n, int timeout_ms);
+
 #endif /* INC_LDC1101_H_ */
\ No newline at end of file
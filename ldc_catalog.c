@@ -0,0 +1,77 @@
+/**
+ * @file ldc_catalog.c
+ * @brief Query the run catalog written by main(). Each argument is a filter
+ * "field<op>value" (op: = != < <= > >= ~) and all of them must match, e.g.
+ *   ldc_catalog rig=bench2 enob_mean>18 start>=2026-10-01
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "catalog.h"
+
+#define MAX_FILTERS 32
+
+int main(int argc, char *argv[]){
+    int opt = 0;
+    char *path = CATALOG_DEFAULT;
+    int all_fields = 0;
+    int count_only = 0;
+    struct catalog_filter filters[MAX_FILTERS];
+    int num_filters = 0;
+
+    while ((opt = getopt(argc, argv, "hf:ac")) != -1) {
+        switch(opt) {
+            case 'f':
+                path = optarg;
+                break;
+            case 'a':
+                all_fields = 1;
+                break;
+            case 'c':
+                count_only = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-f catalog] [-a all fields] [-c count only] [field<op>value]...\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        if (num_filters == MAX_FILTERS || catalog_filter_parse(&filters[num_filters++], argv[i]) == -1) {
+            fprintf(stderr, "Bad filter '%s'\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "Failed to open catalog %s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    struct catalog_entry e;
+    unsigned long total = 0, matched = 0;
+    int got;
+    while ((got = catalog_read(f, &e)) != 0) {
+        total++;
+        if (got == -1) {
+            fprintf(stderr, "Corrupt catalog record %lu\n", total);
+            break;
+        }
+        int ok = 1;
+        for (int i = 0; i < num_filters && ok; i++) {
+            ok = catalog_filter_match(&filters[i], &e);
+        }
+        if (ok) {
+            matched++;
+            if (!count_only) {
+                catalog_print(stdout, &e, all_fields);
+            }
+        }
+    }
+    fclose(f);
+    fprintf(count_only ? stdout : stderr, "%lu of %lu runs\n", matched, total);
+    return 0;
+}
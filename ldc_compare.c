@@ -0,0 +1,165 @@
+/**
+ * @file ldc_compare.c
+ * @brief Run-to-run comparison of binary logs aligned by command value.
+ * The first log is the reference. Each log is memory-mapped and reduced to
+ * per-step statistics on its own thread, then every other run's steps are
+ * matched to the reference steps with the same command (by step number when
+ * commands are unknown). The tool reports the mean shift and the noise ratio
+ * with 95% confidence intervals, and flags significant changes.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include "binlog.h"
+#include "step_stats.h"
+
+#define Z95 1.96
+
+struct run {
+    const char *path;
+    struct binlog_reader log;
+    struct step_stats *steps;
+    int num_steps;
+    int ok;
+};
+
+static void *reduce_run(void *arg){
+    struct run *run = arg;
+    if (binlog_open(&run->log, run->path) == -1) {
+        return NULL;
+    }
+    run->num_steps = run->log.num_steps;
+    run->steps = calloc(run->num_steps ? run->num_steps : 1, sizeof(*run->steps));
+    if (run->steps == NULL) {
+        return NULL;
+    }
+    for (int s = 0; s < run->num_steps; s++) {
+        const struct binlog_step *bs = &run->log.steps[s];
+        struct step_stats *st = &run->steps[s];
+        step_stats_init(st, bs->step, (int16_t)bs->cmd_val);
+        for (int b = bs->first_block; b < bs->first_block + bs->num_blocks; b++) {
+            const struct binlog_record *rec = binlog_block_records(&run->log, b);
+            uint32_t count = binlog_block_at(&run->log, b)->count;
+            for (uint32_t i = 0; i < count; i++) {
+                step_stats_add(st, rec[i].t_ns * 1e-9, rec[i].code);
+            }
+        }
+    }
+    run->ok = 1;
+    return NULL;
+}
+
+/**
+ * @brief Step of run matching the reference step (same command, else same index)
+ */
+static const struct step_stats *match_step(const struct run *run, const struct run *ref, int s){
+    const struct binlog_step *want = &ref->log.steps[s];
+    for (int i = 0; i < run->num_steps; i++) {
+        const struct binlog_step *bs = &run->log.steps[i];
+        if (want->cmd_val != BINLOG_CMD_UNKNOWN ? bs->cmd_val == want->cmd_val : bs->step == want->step) {
+            return &run->steps[i];
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]){
+    int opt = 0;
+    double z_flag = 3.0; // |z| beyond which a shift is flagged
+    int flagged_only = 0;
+
+    openlog(NULL, LOG_PERROR, LOG_LOCAL6); // binlog reports errors via syslog
+
+    while ((opt = getopt(argc, argv, "hz:f")) != -1) {
+        switch(opt) {
+            case 'z':
+                z_flag = atof(optarg);
+                break;
+            case 'f':
+                flagged_only = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-z flag threshold] [-f flagged steps only] reference.ldcb run.ldcb...\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    int num_runs = argc - optind;
+    if (num_runs < 2) {
+        fprintf(stderr, "Need a reference log and at least one other\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct run *runs = calloc(num_runs, sizeof(*runs));
+    pthread_t *threads = calloc(num_runs, sizeof(*threads));
+    for (int r = 0; r < num_runs; r++) {
+        runs[r].path = argv[optind + r];
+        pthread_create(&threads[r], NULL, reduce_run, &runs[r]);
+    }
+    for (int r = 0; r < num_runs; r++) {
+        pthread_join(threads[r], NULL);
+        if (!runs[r].ok) {
+            fprintf(stderr, "Failed to read %s\n", runs[r].path);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    const struct run *ref = &runs[0];
+    int exit_status = 0;
+    for (int r = 1; r < num_runs; r++) {
+        const struct run *run = &runs[r];
+        int matched = 0, flagged = 0;
+        double shift_sum = 0;
+
+        printf("%s vs %s\n", run->path, ref->path);
+        printf("%6s %7s %14s %12s %25s %9s %9s %17s\n", "step", "cmd", "ref mean", "shift",
+               "95% CI", "ref rms", "rms ratio", "95% CI");
+        for (int s = 0; s < ref->num_steps; s++) {
+            const struct step_stats *a = &ref->steps[s];
+            const struct step_stats *b = match_step(run, ref, s);
+            if (b == NULL || a->n < 3 || b->n < 3) {
+                continue;
+            }
+            matched++;
+
+            // mean shift, with the trend residual as the per-sample noise
+            double rms_a = step_stats_noise_rms(a), rms_b = step_stats_noise_rms(b);
+            double shift = b->mean_y - a->mean_y;
+            double se = sqrt(rms_a * rms_a / a->n + rms_b * rms_b / b->n);
+            double z = se > 0 ? shift / se : 0;
+
+            // noise ratio on a log scale, se of log(s) is about 1/sqrt(2(n-1))
+            double ratio = rms_a > 0 ? rms_b / rms_a : 0;
+            double se_log = sqrt(0.5 / (a->n - 1) + 0.5 / (b->n - 1));
+            double z_ratio = ratio > 0 ? log(ratio) / se_log : 0;
+
+            int flag = fabs(z) > z_flag || fabs(z_ratio) > z_flag;
+            flagged += flag;
+            shift_sum += shift;
+            if (flagged_only && !flag) {
+                continue;
+            }
+            printf("%6d %7d %14.1f %+12.2f [%+10.2f, %+10.2f] %9.2f %9.3f [%6.3f, %6.3f]%s\n",
+                   a->step, a->cmd_val, a->mean_y, shift, shift - Z95 * se, shift + Z95 * se, rms_a,
+                   ratio, ratio * exp(-Z95 * se_log), ratio * exp(Z95 * se_log),
+                   flag ? (fabs(z) > z_flag ? "  SHIFT" : "  NOISE") : "");
+        }
+        printf("%d steps matched, %d flagged, mean shift %+.2f codes\n\n", matched, flagged,
+               matched ? shift_sum / matched : 0.0);
+        if (flagged > 0) {
+            exit_status = 1;
+        }
+    }
+
+    for (int r = 0; r < num_runs; r++) {
+        binlog_reader_close(&runs[r].log);
+        free(runs[r].steps);
+    }
+    free(runs);
+    free(threads);
+    return exit_status;
+}
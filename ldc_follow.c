@@ -0,0 +1,153 @@
+/**
+ * @file ldc_follow.c
+ * @brief Live analysis of a binary log that main() is still writing (-b).
+ * The log is mapped once and re-indexed on every inotify change, so only
+ * the blocks appended since the last change are read. Per-step statistics
+ * and quantile sketches are kept incrementally; each step is reported (the
+ * run summary metric line, and the summary JSON with -o) as soon as the
+ * first block of the next step shows it has finished. The tool exits when
+ * the writer closes the log.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "binlog.h"
+#include "run_summary.h"
+
+static struct binlog_reader log;
+static struct run_summary summary;
+static struct step_stats cur;
+static struct kll_sketch sketch;
+static int have_step = 0;
+static int next_block = 0; // first block not yet analysed
+static const char *summary_out = NULL;
+
+/**
+ * @brief Write the summary next to its final name and rename it over, so a
+ * dashboard polling the file never reads half of it
+ */
+static int publish_summary(void){
+    char tmp[PATH_MAX];
+    if (summary_out == NULL) {
+        return 0;
+    }
+    snprintf(tmp, sizeof(tmp), "%s.tmp", summary_out);
+    if (run_summary_write(&summary, tmp) == -1) {
+        return -1;
+    }
+    if (rename(tmp, summary_out) == -1) {
+        syslog(LOG_ERR, "Failed to replace %s: %s", summary_out, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static void finish_step(void){
+    if (have_step) {
+        run_summary_add_step(&summary, &cur, &sketch);
+        have_step = 0;
+    }
+}
+
+/**
+ * @brief Analyse the blocks indexed since the last call
+ * @return number of steps finished
+ */
+static int analyse_new_blocks(void){
+    int finished = 0;
+    for (; next_block < log.num_blocks; next_block++) {
+        const struct binlog_block *blk = binlog_block_at(&log, next_block);
+        const struct binlog_record *rec = binlog_block_records(&log, next_block);
+        if (have_step && ((uint32_t)cur.step != blk->step || cur.cmd_val != (int16_t)blk->cmd_val)) {
+            finish_step();
+            finished++;
+        }
+        if (!have_step) {
+            step_stats_init(&cur, blk->step, (int16_t)blk->cmd_val);
+            kll_init(&sketch);
+            have_step = 1;
+        }
+        for (uint32_t i = 0; i < blk->count; i++) {
+            step_stats_add(&cur, rec[i].t_ns * 1e-9, rec[i].code);
+            kll_update(&sketch, rec[i].code);
+        }
+    }
+    return finished;
+}
+
+int main(int argc, char *argv[]){
+    int opt = 0;
+    int done = 0;
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    openlog(NULL, LOG_PERROR, LOG_LOCAL6); // the metric lines are the output
+
+    while ((opt = getopt(argc, argv, "ho:")) != -1) {
+        switch(opt) {
+            case 'o':
+                summary_out = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-o summary.json] log.ldcb\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "Need one binary log\n");
+        exit(EXIT_FAILURE);
+    }
+    const char *path = argv[optind];
+
+    // watch before opening so no append between the two is missed
+    int in_fd = inotify_init1(IN_CLOEXEC);
+    if (in_fd == -1 || inotify_add_watch(in_fd, path, IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF) == -1) {
+        fprintf(stderr, "%s: cannot watch: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    if (binlog_open(&log, path) == -1 || run_summary_init(&summary, 0) == -1) {
+        exit(EXIT_FAILURE);
+    }
+
+    // catch up with what was written before we started
+    if (analyse_new_blocks() > 0) {
+        publish_summary();
+    }
+    while (!done) {
+        ssize_t len = read(in_fd, events, sizeof(events));
+        if (len == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            syslog(LOG_ERR, "inotify read failed: %s", strerror(errno));
+            break;
+        }
+        for (char *p = events; p < events + len; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if (ev->mask & (IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                done = 1;
+            }
+            p += sizeof(*ev) + ev->len;
+        }
+        if (binlog_refresh(&log) == -1) {
+            break;
+        }
+        if (analyse_new_blocks() > 0) {
+            publish_summary();
+        }
+    }
+
+    // the writer is gone, so the last step is complete
+    finish_step();
+    publish_summary();
+    printf("%s: %d steps, %lu samples\n", path, summary.num_steps, summary.samples);
+    run_summary_free(&summary);
+    binlog_reader_close(&log);
+    close(in_fd);
+    return done ? 0 : 1;
+}
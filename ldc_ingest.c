@@ -0,0 +1,218 @@
+/**
+ * @file ldc_ingest.c
+ * @brief Converts "Timestamp, Value" CSV logs written by main() into indexed
+ * binary logs (binlog.h). Files are converted in parallel, one per worker.
+ * @note Legacy logs do not record steps. With -n the step is the sample
+ * index divided by the samples per step (main's -n); otherwise a new step
+ * starts at every gap much longer than the median sample interval, which is
+ * where main() paused to send a command. -c/-v rebuild the command values
+ * the same way main() generates them.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "binlog.h"
+#include "csv_scan.h"
+
+#define GAP_FACTOR 10 // step boundary: gap > GAP_FACTOR x median interval
+
+static char **files;
+static int num_files;
+static atomic_int next_file;
+static atomic_int failures;
+static char *out_dir = NULL;
+static int samples_per_step = 0;
+static int have_cmds = 0;
+static int start_cmd = 100; // main()'s start_value
+static int cmd_inc = 1000;  // main()'s default -v
+
+static int cmp_i64(const void *a, const void *b){
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int64_t median_interval(const struct csv_samples *s){
+    if (s->count < 2) {
+        return 0;
+    }
+    int64_t *dt = malloc((s->count - 1) * sizeof(*dt));
+    if (dt == NULL) {
+        return 0;
+    }
+    for (size_t i = 1; i < s->count; i++) {
+        dt[i - 1] = s->t_ns[i] - s->t_ns[i - 1];
+    }
+    qsort(dt, s->count - 1, sizeof(*dt), cmp_i64);
+    int64_t m = dt[(s->count - 1) / 2];
+    free(dt);
+    return m;
+}
+
+static int32_t step_cmd(uint32_t step){
+    if (!have_cmds) {
+        return BINLOG_CMD_UNKNOWN;
+    }
+    // main() sends start_value first, then step * increment
+    return step == 0 ? start_cmd : (int32_t)step * cmd_inc;
+}
+
+static int ingest(const char *path){
+    char out_path[512];
+    char base[256];
+    struct stat sb;
+    struct csv_samples s;
+    struct binlog_writer w;
+
+    memset(&s, 0, sizeof(s));
+    int fd = open(path, O_RDONLY);
+    if (fd == -1 || fstat(fd, &sb) == -1) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+    if (sb.st_size == 0) {
+        close(fd);
+        fprintf(stderr, "%s: empty\n", path);
+        return -1;
+    }
+    const char *buf = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (buf == MAP_FAILED) {
+        fprintf(stderr, "%s: mmap: %s\n", path, strerror(errno));
+        return -1;
+    }
+    madvise((void *)buf, sb.st_size, MADV_SEQUENTIAL);
+    int ret = csv_scan(buf, sb.st_size, &s);
+    munmap((void *)buf, sb.st_size);
+    if (ret == -1 || s.count == 0) {
+        fprintf(stderr, "%s: no samples\n", path);
+        csv_samples_free(&s);
+        return -1;
+    }
+
+    strncpy(base, path, sizeof(base) - 1);
+    base[sizeof(base) - 1] = '\0';
+    char *name = basename(base);
+    char *ext = strrchr(name, '.');
+    if (ext != NULL && strcmp(ext, ".csv") == 0) {
+        *ext = '\0';
+    }
+    if (out_dir != NULL) {
+        snprintf(out_path, sizeof(out_path), "%s/%s.ldcb", out_dir, name);
+    } else {
+        char dir[256];
+        strncpy(dir, path, sizeof(dir) - 1);
+        dir[sizeof(dir) - 1] = '\0';
+        snprintf(out_path, sizeof(out_path), "%s/%s.ldcb", dirname(dir), name);
+    }
+
+    // the file was last written at the end of the run
+    int64_t start_ns = (int64_t)sb.st_mtim.tv_sec * 1000000000 + sb.st_mtim.tv_nsec - s.t_ns[s.count - 1];
+    if (binlog_create(&w, out_path, name, start_ns) == -1) {
+        fprintf(stderr, "%s: cannot create\n", out_path);
+        csv_samples_free(&s);
+        return -1;
+    }
+
+    int64_t gap = GAP_FACTOR * median_interval(&s);
+    uint32_t step = 0;
+    binlog_step(&w, step, step_cmd(step));
+    for (size_t i = 0; i < s.count; i++) {
+        int new_step = samples_per_step > 0
+            ? (i > 0 && i % samples_per_step == 0)
+            : (i > 0 && gap > 0 && s.t_ns[i] - s.t_ns[i - 1] > gap);
+        if (new_step) {
+            step++;
+            ret |= binlog_step(&w, step, step_cmd(step));
+        }
+        ret |= binlog_append(&w, s.t_ns[i], s.code[i], 0);
+    }
+    ret |= binlog_close(&w);
+
+    printf("%s -> %s: %zu samples, %u steps, %zu lines skipped\n", path, out_path,
+           s.count, step + 1, s.skipped);
+    csv_samples_free(&s);
+    return ret;
+}
+
+static void *worker(void *arg){
+    (void)arg;
+    for (int i = atomic_fetch_add(&next_file, 1); i < num_files; i = atomic_fetch_add(&next_file, 1)) {
+        if (ingest(files[i]) == -1) {
+            atomic_fetch_add(&failures, 1);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]){
+    int opt = 0;
+    long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    openlog(NULL, LOG_PERROR, LOG_LOCAL6); // binlog reports errors via syslog
+
+    while ((opt = getopt(argc, argv, "hj:o:n:c:v:")) != -1) {
+        switch(opt) {
+            case 'j':
+                num_threads = atoi(optarg);
+                break;
+            case 'o':
+                out_dir = optarg;
+                break;
+            case 'n':
+                samples_per_step = atoi(optarg);
+                break;
+            case 'c':
+                start_cmd = atoi(optarg);
+                have_cmds = 1;
+                break;
+            case 'v':
+                cmd_inc = atoi(optarg);
+                have_cmds = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-j threads] [-o out dir] [-n samples per step] "
+                        "[-c start command] [-v command increment] log.csv...\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    files = &argv[optind];
+    num_files = argc - optind;
+    if (num_files == 0) {
+        fprintf(stderr, "No input files\n");
+        exit(EXIT_FAILURE);
+    }
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    if (num_threads > num_files) {
+        num_threads = num_files;
+    }
+
+    pthread_t *threads = calloc(num_threads, sizeof(*threads));
+    for (long t = 0; t < num_threads; t++) {
+        pthread_create(&threads[t], NULL, worker, NULL);
+    }
+    for (long t = 0; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+
+    if (failures > 0) {
+        fprintf(stderr, "%d of %d files failed\n", (int)failures, num_files);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file ldc_quantiles.c
+ * @brief Merge the per-step quantile sketches of several run summaries
+ * (<log>.summary.json) by command value and print the combined code tails.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "kll.h"
+
+#define MAX_CMDS 1024
+
+struct cmd_sketch {
+    int cmd;
+    int runs;
+    struct kll_sketch sketch;
+};
+
+static struct cmd_sketch cmds[MAX_CMDS];
+static int num_cmds = 0;
+
+static char *read_file(const char *path){
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    rewind(f);
+    char *text = malloc(len + 1);
+    if (text != NULL) {
+        text[fread(text, 1, len, f)] = '\0';
+    }
+    fclose(f);
+    return text;
+}
+
+static struct cmd_sketch *find_cmd(int cmd){
+    for (int i = 0; i < num_cmds; i++) {
+        if (cmds[i].cmd == cmd) {
+            return &cmds[i];
+        }
+    }
+    if (num_cmds == MAX_CMDS) {
+        return NULL;
+    }
+    struct cmd_sketch *c = &cmds[num_cmds++];
+    c->cmd = cmd;
+    c->runs = 0;
+    kll_init(&c->sketch);
+    return c;
+}
+
+static int cmp_cmd(const void *a, const void *b){
+    return ((const struct cmd_sketch *)a)->cmd - ((const struct cmd_sketch *)b)->cmd;
+}
+
+int main(int argc, char *argv[]){
+    static struct kll_sketch step;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s run.summary.json...\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    for (int a = 1; a < argc; a++) {
+        char *text = read_file(argv[a]);
+        if (text == NULL) {
+            fprintf(stderr, "%s: %s\n", argv[a], strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        const char *p = text;
+        int steps = 0;
+        while ((p = strstr(p, "\"cmd\": ")) != NULL) {
+            int cmd = atoi(p + strlen("\"cmd\": "));
+            const char *sk = strstr(p, "\"sketch\": ");
+            if (sk == NULL || kll_read_json(&step, sk, &p) == -1) {
+                fprintf(stderr, "%s: bad sketch for command %d\n", argv[a], cmd);
+                exit(EXIT_FAILURE);
+            }
+            struct cmd_sketch *c = find_cmd(cmd);
+            if (c == NULL) {
+                fprintf(stderr, "Too many command values\n");
+                exit(EXIT_FAILURE);
+            }
+            kll_merge(&c->sketch, &step);
+            c->runs++;
+            steps++;
+        }
+        free(text);
+        fprintf(stderr, "%s: %d steps\n", argv[a], steps);
+    }
+
+    qsort(cmds, num_cmds, sizeof(*cmds), cmp_cmd);
+    printf("%7s %5s %10s %10s %10s %10s %10s %10s\n", "cmd", "runs", "samples", "min", "p1", "p50", "p99", "max");
+    for (int i = 0; i < num_cmds; i++) {
+        const struct kll_sketch *s = &cmds[i].sketch;
+        printf("%7d %5d %10llu %10u %10u %10u %10u %10u\n", cmds[i].cmd, cmds[i].runs,
+               (unsigned long long)s->n, s->min, kll_quantile(s, 0.01), kll_quantile(s, 0.50),
+               kll_quantile(s, 0.99), s->max);
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+/**
+ * @file ldc_replay.c
+ * @brief Controller-in-the-loop replay of recorded binary logs. The samples
+ * are fed, with their recorded timestamps, through the same sweep code that
+ * main() runs live (sweep.h): step statistics, adaptive RCOUNT and drift
+ * revisit scheduling. Every command and RCOUNT change the sweep asks for is
+ * captured and the commands are compared with the ones recorded in the log.
+ * Replay runs as fast as the CPU allows, no sleeping between samples.
+ * @note Revisit samples are not stored in binary logs, so a replayed drift
+ * model only ever holds its baseline point.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+#include "binlog.h"
+#include "sweep.h"
+
+enum event_kind { EV_COMMAND, EV_REVISIT, EV_STOP, EV_RCOUNT };
+
+static const char *event_names[] = {"command", "revisit", "stop", "rcount"};
+
+struct event {
+    double t;
+    int step;           // step that was running
+    enum event_kind kind;
+    int value;          // command or RCOUNT
+    int32_t recorded;   // command the log holds for the next step
+};
+
+static struct event *events = NULL;
+static int num_events = 0;
+static int events_cap = 0;
+
+static void capture(double t, int step, enum event_kind kind, int value, int32_t recorded){
+    if (num_events == events_cap) {
+        int cap = events_cap ? 2 * events_cap : 256;
+        struct event *e = realloc(events, cap * sizeof(*e));
+        if (e == NULL) {
+            return; // counted as missing in the report
+        }
+        events = e;
+        events_cap = cap;
+    }
+    events[num_events++] = (struct event){t, step, kind, value, recorded};
+}
+
+static double now_s(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Replay one log
+ * @return number of command differences, -1 on failure
+ */
+static int replay(const char *path, const struct sweep_plan *base_plan, const char *summary_out, int verbose){
+    static struct sweep sw;
+    struct binlog_reader log;
+    struct sweep_plan plan = *base_plan;
+    int revisit = 0;
+    double t = 0, t_first = -1;
+
+    if (binlog_open(&log, path) == -1) {
+        return -1;
+    }
+    if (plan.num_steps <= 0) {
+        plan.num_steps = log.num_steps;
+    }
+    if (sweep_init(&sw, &plan) == -1) {
+        binlog_reader_close(&log);
+        return -1;
+    }
+    num_events = 0;
+
+    double wall = now_s();
+    int s = 0;
+    for (; s < log.num_steps && sweep_running(&sw); s++) {
+        const struct binlog_step *bs = &log.steps[s];
+        sweep_step_begin(&sw);
+        for (int b = bs->first_block; b < bs->first_block + bs->num_blocks; b++) {
+            const struct binlog_record *rec = binlog_block_records(&log, b);
+            uint32_t count = binlog_block_at(&log, b)->count;
+            for (uint32_t i = 0; i < count; i++) {
+                t = rec[i].t_ns * 1e-9;
+                if (t_first < 0) {
+                    t_first = t;
+                }
+                if (sweep_sample(&sw, t, rec[i].code)) {
+                    capture(t, sw.step, EV_RCOUNT, sweep_rcount(&sw), BINLOG_CMD_UNKNOWN);
+                }
+            }
+        }
+
+        int32_t recorded = s + 1 < log.num_steps ? log.steps[s + 1].cmd_val : BINLOG_CMD_UNKNOWN;
+        int ret = sweep_step_end(&sw, &revisit);
+        if (revisit) {
+            capture(t, sw.step, EV_REVISIT, plan.start_cmd, BINLOG_CMD_UNKNOWN);
+        }
+        if (ret == -1) {
+            capture(t, sw.step, EV_STOP, sw.cmd_val, recorded);
+            break;
+        }
+        capture(t, sw.step, EV_COMMAND, sw.cmd_val, recorded);
+        if (sweep_command_sent(&sw)) {
+            capture(t, sw.step, EV_RCOUNT, sweep_rcount(&sw), BINLOG_CMD_UNKNOWN);
+        }
+    }
+    wall = now_s() - wall;
+
+    int diffs = 0, compared = 0, rcount_changes = 0;
+    for (int i = 0; i < num_events; i++) {
+        const struct event *e = &events[i];
+        int known = e->recorded != BINLOG_CMD_UNKNOWN;
+        int diff = 0;
+        if (e->kind == EV_RCOUNT) {
+            rcount_changes++;
+        } else if (e->kind != EV_REVISIT && known) {
+            // a stop differs when the log went on to another step
+            diff = e->kind == EV_STOP || e->value != e->recorded;
+            compared++;
+        }
+        diffs += diff;
+        if (verbose || diff) {
+            printf("%14.6f %6d %-8s %7d", e->t, e->step, event_names[e->kind], e->value);
+            if (known) {
+                printf(" recorded %7d%s", e->recorded, diff ? "  DIFF" : "");
+            }
+            printf("\n");
+        }
+    }
+    // steps the log has beyond the end of the replayed plan
+    if (s + 1 < log.num_steps && sweep_running(&sw) == 0) {
+        printf("%s: log continues for %d steps after the plan ended\n", path, log.num_steps - s - 1);
+        diffs++;
+    }
+
+    double span = t_first >= 0 ? t - t_first : 0;
+    printf("%s: %d steps, %lu samples in %.3f s (%.0fx real time), %d commands compared, %d differ, %d RCOUNT changes\n",
+           path, sw.steps_done, sw.summary.samples, wall, wall > 0 ? span / wall : 0.0, compared, diffs, rcount_changes);
+    if (summary_out != NULL && run_summary_write(&sw.summary, summary_out) == -1) {
+        diffs = -1;
+    }
+    sweep_free(&sw);
+    binlog_reader_close(&log);
+    return diffs;
+}
+
+int main(int argc, char *argv[]){
+    int opt = 0;
+    struct sweep_plan plan;
+    char *endp = NULL;
+    char *summary_out = NULL;
+    int verbose = 0;
+
+    openlog(NULL, LOG_PERROR, LOG_LOCAL6); // binlog reports errors via syslog
+    setlogmask(LOG_UPTO(LOG_WARNING)); // not the per-step metric lines
+
+    sweep_plan_default(&plan);
+    plan.num_steps = 0; // all steps of the log
+
+    while ((opt = getopt(argc, argv, "hs:c:v:m:a:D:o:V")) != -1) {
+        switch(opt) {
+            case 's':
+                plan.num_steps = atoi(optarg);
+                break;
+            case 'c':
+                plan.start_cmd = atoi(optarg);
+                break;
+            case 'v':
+                plan.cmd_inc = atoi(optarg);
+                break;
+            case 'm':
+                plan.max_cmd = atoi(optarg);
+                break;
+            case 'a':
+                plan.fast_rcount = strtol(optarg, &endp, 0);
+                if (*endp == ':') {
+                    plan.slope_thresh = atof(endp + 1);
+                }
+                plan.adaptive = 1;
+                break;
+            case 'D':
+                plan.drift_every = strtol(optarg, &endp, 0);
+                if (*endp == ':' && drift_parse_model(endp + 1, &plan.drift_model) == -1) {
+                    fprintf(stderr, "Unknown drift model %s\n", endp + 1);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'o':
+                summary_out = optarg;
+                break;
+            case 'V':
+                verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-s steps] [-c start command] [-v command increment] [-m max command] "
+                        "[-a fast_rcount[:slope]] [-D every[:model]] [-o summary.json] [-V] log.ldcb...\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (optind == argc) {
+        fprintf(stderr, "No input files\n");
+        exit(EXIT_FAILURE);
+    }
+    if (summary_out != NULL && argc - optind > 1) {
+        fprintf(stderr, "-o takes a single log\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int exit_status = 0;
+    for (int i = optind; i < argc; i++) {
+        int diffs = replay(argv[i], &plan, summary_out, verbose);
+        if (diffs != 0) {
+            exit_status = 1;
+        }
+    }
+    free(events);
+    return exit_status;
+}
@@ -0,0 +1,258 @@
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include "ldc1101.h"
+#include "ldc_sim.h"
+
+#define SIM_CHIP_ID 0xD4
+#define SIM_RID 0x02
+
+static double now_s(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static double uniform(struct ldc_sim *sim){
+    // xorshift64*
+    sim->rng ^= sim->rng >> 12;
+    sim->rng ^= sim->rng << 25;
+    sim->rng ^= sim->rng >> 27;
+    return ((sim->rng * 0x2545F4914F6CDD1Dull) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double gaussian(struct ldc_sim *sim){
+    double u = uniform(sim);
+    double v = uniform(sim);
+    return sqrt(-2.0 * log(u > 0 ? u : 1e-300)) * cos(2 * M_PI * v);
+}
+
+void ldc_sim_model_default(struct ldc_sim_model *m){
+    memset(m, 0, sizeof(*m));
+    m->clkin_mhz = 16.0;
+    m->l0_uh = 18.0;
+    m->c_pf = 100.0;
+    m->coil_radius_mm = 7.0;
+    m->coupling = 0.6;
+    m->standoff_mm = 2.0;
+    m->um_per_cmd = 0.1;
+    m->act_tau_ms = 5.0;
+    m->channel = 12;
+    m->channel_spread = 2.0;
+    m->rp_far_kohm = 12.0;
+    m->rp_min_kohm = 1.0;
+    m->white_ppm = 0.5;
+    m->flicker_ppm = 0.2;
+    m->temp_c = 25.0;
+    m->warmup_c = 3.0;
+    m->warmup_s = 300.0;
+    m->tc_l_ppm = 25.0;
+    m->tc_c_ppm = 50.0;
+    m->seed = 1;
+}
+
+void ldc_sim_init(struct ldc_sim *sim, const struct ldc_sim_model *m){
+    memset(sim, 0, sizeof(*sim));
+    pthread_mutex_init(&sim->lock, NULL);
+    sim->m = *m;
+    sim->rng = 0x9E3779B97F4A7C15ull ^ (uint64_t)m->seed;
+    sim->t0 = sim->t_pos = now_s();
+    double sum = 0;
+    for (int j = 0; j < LDC_SIM_CHANNELS; j++) {
+        double d = (j - m->channel) / (m->channel_spread > 0 ? m->channel_spread : 1);
+        sim->weight[j] = 1 / (1 + d * d);
+        sum += sim->weight[j];
+    }
+    for (int j = 0; j < LDC_SIM_CHANNELS; j++) {
+        sim->weight[j] /= sum;
+    }
+    sim->regs[LDC1101_START_CONFIG] = 0x01; // sleep
+    sim->regs[LDC1101_LHR_RCOUNT_LSB] = 0xFF;
+    sim->regs[LDC1101_LHR_RCOUNT_MSB] = 0xFF;
+    sim->regs[LDC1101_LHR_STATUS] = LDC1101_LHR_DRDY;
+    sim->regs[LDC1101_RID] = SIM_RID;
+    sim->regs[LDC1101_CHIP_ID] = SIM_CHIP_ID;
+}
+
+static void update_position(struct ldc_sim *sim, double t){
+    double dt = t - sim->t_pos;
+    if (dt > 0) {
+        double tau = sim->m.act_tau_ms * 1e-3;
+        sim->pos_um += (sim->target_um - sim->pos_um) * (tau > 0 ? 1 - exp(-dt / tau) : 1);
+        sim->t_pos = t;
+    }
+}
+
+/**
+ * @brief Move the target position with the command, through the play band
+ */
+static void set_target(struct ldc_sim *sim, double cmd){
+    double x = cmd * sim->m.um_per_cmd;
+    double half = sim->m.backlash_um / 2;
+    if (sim->target_um < x - half) {
+        sim->target_um = x - half;
+    } else if (sim->target_um > x + half) {
+        sim->target_um = x + half;
+    }
+}
+
+void ldc_sim_command(struct ldc_sim *sim, int16_t cmd){
+    pthread_mutex_lock(&sim->lock);
+    update_position(sim, now_s());
+    set_target(sim, cmd);
+    pthread_mutex_unlock(&sim->lock);
+}
+
+void ldc_sim_frame(struct ldc_sim *sim, const int16_t *values, int n){
+    double cmd = 0;
+    for (int j = 0; j < n && j < LDC_SIM_CHANNELS; j++) {
+        cmd += sim->weight[j] * values[j];
+    }
+    pthread_mutex_lock(&sim->lock);
+    update_position(sim, now_s());
+    set_target(sim, cmd);
+    pthread_mutex_unlock(&sim->lock);
+}
+
+double ldc_sim_frequency(const struct ldc_sim *sim, double gap_mm, double temp_c, double *rp_kohm){
+    const struct ldc_sim_model *m = &sim->m;
+    double x = gap_mm / m->coil_radius_mm;
+    double k = m->coupling * pow(1 + x * x, -1.5);
+    double dtemp = temp_c - m->temp_c;
+    double l = m->l0_uh * 1e-6 * (1 - k * k) * (1 + m->tc_l_ppm * 1e-6 * dtemp);
+    double c = m->c_pf * 1e-12 * (1 + m->tc_c_ppm * 1e-6 * dtemp);
+    if (rp_kohm != NULL) {
+        *rp_kohm = m->rp_far_kohm * (1 - k * k / (m->coupling * m->coupling) * 0.95);
+    }
+    return 1.0 / (2 * M_PI * sqrt(l * c));
+}
+
+static uint32_t rcount(const struct ldc_sim *sim){
+    return sim->regs[LDC1101_LHR_RCOUNT_MSB] << 8 | sim->regs[LDC1101_LHR_RCOUNT_LSB];
+}
+
+static double conversion_time(const struct ldc_sim *sim){
+    return (16.0 * rcount(sim) + 55) / (sim->m.clkin_mhz * 1e6);
+}
+
+/**
+ * @brief Finish the conversion ending at t: latch LHR_DATA and the error flags
+ */
+static void convert(struct ldc_sim *sim, double t){
+    const struct ldc_sim_model *m = &sim->m;
+    double t_conv = conversion_time(sim);
+    update_position(sim, t);
+
+    double elapsed = t - sim->t0;
+    double temp = m->temp_c + m->warmup_c * (1 - exp(-elapsed / m->warmup_s));
+    double rp = 0;
+    double gap = m->standoff_mm + sim->pos_um * 1e-3;
+    double f = ldc_sim_frequency(sim, gap > 0 ? gap : 0, temp, &rp);
+
+    // white noise averages down with the conversion length
+    double f_clk = m->clkin_mhz * 1e6;
+    double t_max = (16.0 * 0xFFFF + 55) / f_clk;
+    double white = m->white_ppm * 1e-6 * sqrt(t_max / t_conv);
+    // 1/f: equal-power AR(1) sources with corner times 10 ms .. 100 s
+    double flick = 0;
+    for (int i = 0; i < LDC_SIM_FLICKER_POLES; i++) {
+        double tau = 0.01 * pow(10, i);
+        double a = exp(-t_conv / tau);
+        sim->flicker[i] = a * sim->flicker[i] + sqrt(1 - a * a) * gaussian(sim);
+        flick += sim->flicker[i];
+    }
+    flick *= m->flicker_ppm * 1e-6 / sqrt(LDC_SIM_FLICKER_POLES);
+    f *= 1 + white * gaussian(sim) + flick;
+
+    uint8_t status = 0;
+    double code = 0;
+    if (rp < m->rp_min_kohm) {
+        status |= LDC1101_ERR_ZC; // no oscillation to count
+    } else if (f >= f_clk) {
+        status |= LDC1101_ERR_OR;
+        code = 0xFFFFFF;
+    } else {
+        // the counter resolves one reference period per 16 RCOUNT window
+        double q = (double)(1 << 24) / (16.0 * (rcount(sim) ? rcount(sim) : 1));
+        double ideal = f / f_clk * (1 << 24);
+        code = floor(ideal / q + uniform(sim)) * q;
+        uint32_t offset = sim->regs[LDC1101_LHR_OFFSET_MSB] << 8 | sim->regs[LDC1101_LHR_OFFSET_LSB];
+        code -= offset * 256.0;
+        if (code < 0) {
+            status |= LDC1101_ERR_UR;
+            code = 0;
+        } else if (code > 0xFFFFFF) {
+            status |= LDC1101_ERR_OF;
+            code = 0xFFFFFF;
+        }
+    }
+    uint32_t c = (uint32_t)code;
+    sim->regs[LDC1101_LHR_DATA_LSB] = c & 0xFF;
+    sim->regs[LDC1101_LHR_DATA_MID] = (c >> 8) & 0xFF;
+    sim->regs[LDC1101_LHR_DATA_MSB] = (c >> 16) & 0xFF;
+    sim->regs[LDC1101_LHR_STATUS] = status; // DRDY bit clear: data ready
+    sim->ready = 1;
+}
+
+/**
+ * @brief Run the conversions that finished by t
+ */
+static void advance(struct ldc_sim *sim, double t){
+    if (!sim->active) {
+        return;
+    }
+    if (t >= sim->conv_end) {
+        // only the latest result is kept, as in the device
+        double t_conv = conversion_time(sim);
+        double end = sim->conv_end + floor((t - sim->conv_end) / t_conv) * t_conv;
+        convert(sim, end);
+        sim->conv_end = end + t_conv;
+    }
+}
+
+static void sleep_until(double t){
+    double wait = t - now_s();
+    if (wait > 0) {
+        struct timespec ts = {(time_t)wait, (long)((wait - (time_t)wait) * 1e9)};
+        nanosleep(&ts, NULL);
+    }
+}
+
+int ldc_sim_spi(struct ldc_sim *sim, uint8_t *data, size_t len){
+    uint8_t reg = data[0] & 0x3F;
+    double t = now_s();
+
+    pthread_mutex_lock(&sim->lock);
+    if (!(data[0] & 0x80)) {
+        if (len > 1) {
+            sim->regs[reg] = data[1];
+            if (reg == LDC1101_START_CONFIG) {
+                sim->active = (data[1] & 0x03) == 0;
+                sim->conv_end = t + conversion_time(sim);
+                sim->ready = 0;
+                sim->regs[LDC1101_LHR_STATUS] |= LDC1101_LHR_DRDY;
+            }
+        }
+        pthread_mutex_unlock(&sim->lock);
+        return len;
+    }
+
+    advance(sim, t);
+    if (reg == LDC1101_LHR_STATUS && sim->active && !sim->ready) {
+        double end = sim->conv_end;
+        pthread_mutex_unlock(&sim->lock); // the actuator keeps moving meanwhile
+        sleep_until(end);
+        pthread_mutex_lock(&sim->lock);
+        advance(sim, now_s());
+    }
+    for (size_t i = 1; i < len; i++) {
+        data[i] = sim->regs[(reg + i - 1) & 0x3F];
+    }
+    if (reg <= LDC1101_LHR_DATA_LSB && reg + len - 1 > LDC1101_LHR_DATA_LSB) {
+        // reading the data releases it
+        sim->ready = 0;
+        sim->regs[LDC1101_LHR_STATUS] |= LDC1101_LHR_DRDY;
+    }
+    pthread_mutex_unlock(&sim->lock);
+    return len;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file ldc_sim.h
+ * @brief Simulated LDC1101 behind the SPI register interface. Actuator
+ * position sets the gap to a conductive target; the gap sets the coil's
+ * coupling to the target and from it the tank inductance, Rp and the sensor
+ * frequency. On top of that come temperature drift of L and C, white and 1/f
+ * frequency noise, conversion timing and quantisation at the programmed
+ * RCOUNT, LHR_OFFSET and the LHR_STATUS error flags.
+ * @note Model: f = 1/(2 pi sqrt(L C)), L = L0 (1 - k^2), with the coupling
+ * k = k0 (1 + (gap/r)^2)^-3/2 of a coil of radius r over a large target;
+ * Rp falls with k^2 and oscillation stops (ERR_ZC) below rp_min.
+ * LHR_DATA = f/f_CLKIN 2^24 - LHR_OFFSET 2^8 and a conversion takes
+ * (16 RCOUNT + 55)/f_CLKIN.
+ */
+
+#ifndef INC_LDC_SIM_H_
+#define INC_LDC_SIM_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LDC_SIM_FLICKER_POLES 5 // 1/f noise from AR(1) sources one decade apart
+#define LDC_SIM_CHANNELS 26     // actuator channels of a CMD_DATA frame
+
+// Coil/target geometry, noise and environment
+struct ldc_sim_model {
+    double clkin_mhz;       // reference clock
+    double l0_uh;           // coil inductance with no target
+    double c_pf;            // tank capacitance
+    double coil_radius_mm;
+    double coupling;        // k0, coil-target coupling at zero gap
+    double standoff_mm;     // gap at command 0
+    double um_per_cmd;      // actuator travel per command unit, gap grows with the command
+    double act_tau_ms;      // actuator first-order time constant
+    double backlash_um;     // width of the actuator's hysteresis (play) band, 0 = none
+    int channel;            // actuator channel nearest the sensor
+    double channel_spread;  // channels over which the influence halves
+    double rp_far_kohm;     // Rp with no target
+    double rp_min_kohm;     // below this the sensor stops oscillating
+    double white_ppm;       // rms frequency noise per conversion at RCOUNT 0xFFFF
+    double flicker_ppm;     // rms of the 1/f frequency noise
+    double temp_c;          // ambient
+    double warmup_c;        // self-heating rise
+    double warmup_s;        // self-heating time constant
+    double tc_l_ppm;        // L temperature coefficient, ppm/K
+    double tc_c_ppm;        // C temperature coefficient, ppm/K
+    int seed;
+};
+
+struct ldc_sim {
+    pthread_mutex_t lock;   // commands may come from another thread than the SPI reads
+    struct ldc_sim_model m;
+    uint8_t regs[64];
+    double t0;              // s, CLOCK_MONOTONIC
+    double pos_um;          // actuator position
+    double target_um;
+    double t_pos;           // last position update
+    double weight[LDC_SIM_CHANNELS]; // influence of each channel, sums to 1
+    double conv_end;        // end of the running conversion, s
+    int active;             // START_CONFIG in active mode
+    int ready;              // a conversion finished since LHR_DATA was read
+    double flicker[LDC_SIM_FLICKER_POLES];
+    uint64_t rng;
+};
+
+/**
+ * @brief Defaults: 16 MHz clock, 18 uH/100 pF tank, 7 mm coil, 2.4 mm travel
+ */
+void ldc_sim_model_default(struct ldc_sim_model *m);
+
+/**
+ * @brief Power-on state: registers at their reset values, sleeping
+ */
+void ldc_sim_init(struct ldc_sim *sim, const struct ldc_sim_model *m);
+
+/**
+ * @brief New actuator command, the position follows with act_tau_ms after
+ * the backlash band
+ */
+void ldc_sim_command(struct ldc_sim *sim, int16_t cmd);
+
+/**
+ * @brief New per-channel commands; the target moves by their influence-weighted sum
+ * @note Influence falls off as 1/(1 + (d/channel_spread)^2) with the
+ * distance d in channels from the sensor's channel.
+ */
+void ldc_sim_frame(struct ldc_sim *sim, const int16_t *values, int n);
+
+/**
+ * @brief One SPI transaction, same framing as wiringPiSPIxDataRW()
+ * @param data data[0] is the register, bit 7 set for a read; read bytes
+ * replace data[1..len-1] (auto-incrementing), a write stores data[1]
+ * @return len
+ * @note A LHR_STATUS read while a conversion runs sleeps until it ends,
+ * standing in for the caller's busy poll.
+ */
+int ldc_sim_spi(struct ldc_sim *sim, uint8_t *data, size_t len);
+
+/**
+ * @brief Sensor frequency, Rp and temperature for a gap, without noise
+ */
+double ldc_sim_frequency(const struct ldc_sim *sim, double gap_mm, double temp_c, double *rp_kohm);
+
+#endif /* INC_LDC_SIM_H_ */
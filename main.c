@@ -15,25 +15,45 @@
 #include <fcntl.h>
 #include <syslog.h>
 #include <time.h>
-#include <wiringPi.h>
-#include <wiringPiSPI.h>
+#include <math.h>
 #include "ldc1101.h"
 #include "UDP_client.h"
+#include "UDP_group.h"
+#include "rcount_adapt.h"
+#include "sweep.h"
+#include "batch_pool.h"
+#include "binlog.h"
+#include "catalog.h"
+#include "autotune.h"
+#include "rig_config.h"
+#include "sysmon.h"
+#include "ldc_sim.h"
+#include "hadamard.h"
+#include "hot_config.h"
+#include "mrc.h"
+#include "ilc.h"
+#include "hyst.h"
+#include "cusum.h"
 
 
-#define SPI_SPEED 1000000 // MHz
-#define SPI_MODE_0 0 // SPI mode 0 (CPOL=0, CPHA=0)
-#define SPI_MODE_3 3 // SPI mode 3 (CPOL=1, CPHA=1)
-#define HIGH_Q_SENSOR 0 << 7
-#define LOPTIMAL 0x01 
-#define DOK_REPORT 0x01
-#define SPI_DEV_ID 0xD4
+#define SAMPLE_BATCH 16 // conversions per ldc1101_read_samples() call
+#define BINLOG_BUFFER_S 2.0 // disk stall the binary log writer thread can absorb
+#define READ_TIMEOUT_CONVERSIONS 10 // conversion times a bounded read waits for DRDY
+#define READ_FAILURES_MAX 5 // consecutive failed reads after which the sensor counts as dead
 
 char ip[]="127.0.0.0";
 char port[] = "2345";
-int spi_fd = 0; // File descriptor for LDC1101 SPI bus
 int spi_num = 0; // SPI channel number
 int spi_chan = 0; // SPI channel 
+int use_group = 0; // 1 when commands fan out to the -t target list
+int use_sim = 0; // 1 when the LDC1101 is simulated (-S)
+struct ldc_sim sim; // simulated sensor behind the SPI calls
+struct ldc1101 ldc; // the sensor
+struct hyst hyst; // actuator hysteresis model (-Y)
+struct hyst *compensator = NULL; // inverse applied by send_position(), NULL when off
+int16_t stop_values[CMD_SIZE/2]; // stop/hold frame of the event detector, host byte order
+union CMD_DATA stop_frame; // the same frame encoded once, ready to send
+int16_t last_cmd = 0; // command send_command() last sent on every channel, after compensation
 
 
 /**
@@ -56,19 +76,30 @@ struct timespec get_elapsed_time(struct timespec start, struct timespec end) {
 }
 
 /** 
- * @brief send command values to actuater.
- * @param cmd_val
+ * @brief send a frame of per-channel command values to the actuater.
+ * @param values CMD_SIZE/2 command values, host byte order
  * @return status: 0 on success, -1 on failure
- * @note This function sends command values to the actuater via UDP.
- * It prepares the command data and sends it using the UDP_send function.
  */
-int send_command(int16_t cmd_val) {
-    union CMD_DATA cmd_data, buf_data;
+int send_command_frame(const int16_t *values) {
+    union CMD_DATA buf_data;
+
+    if (use_sim) {
+        ldc_sim_frame(&sim, values, CMD_SIZE/2); // the simulated target follows the actuator
+    }
 
-    // Prepare the command data
     for(int i = 0; i < CMD_SIZE/2; i++) {
-        cmd_data.values[i] = cmd_val; // Set command value
-        buf_data.values[i] = htons(cmd_val); // Convert to network byte order
+        buf_data.values[i] = htons(values[i]); // Convert to network byte order
+    }
+
+    if (use_group) {
+        // every board gets the frame from one sendmmsg() call
+        int targets = UDP_group_send(buf_data);
+        if (targets <= 0) {
+            fprintf(stderr, "Failed to send command data to any target\n");
+            return -1;
+        }
+        printf("Sent %d bytes to %d targets\n", CMD_SIZE, targets);
+        return 0;
     }
 
     // Send the command buffer values
@@ -81,111 +112,744 @@ int send_command(int16_t cmd_val) {
     return 0;
 }
 
+/** 
+ * @brief send command values to actuater.
+ * @param cmd_val
+ * @return status: 0 on success, -1 on failure
+ * @note This function sends command values to the actuater via UDP.
+ * Every channel gets the same value.
+ */
+int send_command(int16_t cmd_val) {
+    union CMD_DATA cmd_data;
+
+    // Prepare the command data
+    for(int i = 0; i < CMD_SIZE/2; i++) {
+        cmd_data.values[i] = cmd_val; // Set command value
+    }
+    last_cmd = cmd_val;
+    return send_command_frame(cmd_data.values);
+}
+
 /**
- * @brief Set an LDC1101 register with a value
- * @param reg 
- * @param value
- * @return status: 0 on success, exits with EXIT_FAILURE on failure
+ * @brief Encode the stop/hold frame ahead of time, so send_stop() only has to send it
+ * @param cmd_val command every channel stops at
  */
-int ldc1101_set_reg(uint8_t reg, uint8_t value){
-    uint8_t data[2] = {reg, value}; // Prepare data to write
-    int ret_val = wiringPiSPIxDataRW(spi_num, spi_chan, data, sizeof(data));
-    if (ret_val == -1) {
-        syslog(LOG_ERR, "Failed to write to LDC1101 register %d: %s\n", reg, strerror(errno));
-        exit(EXIT_FAILURE); // Error
-    }
-    return 0; // Success
+void prepare_stop(int16_t cmd_val) {
+    for (int i = 0; i < CMD_SIZE/2; i++) {
+        stop_values[i] = cmd_val;
+        stop_frame.values[i] = htons(cmd_val);
+    }
 }
 
 /**
- * @brief Read LDC1101 register data
- * @param reg register address
- * @param data: container for the data
- * @param length: total length in bytes to read
+ * @brief Send the pre-encoded stop/hold frame, nothing else on the way
  * @return status: 0 on success, -1 on failure
  */
-int ldc1101_read_reg(uint8_t reg, uint8_t *data, size_t length) {
-    data[0] = 1<<7|reg; // Set register address to read
-    int ret_val = wiringPiSPIxDataRW(spi_num, spi_chan, data, length + 1); // +1 for register address byte
-    if (ret_val == -1) {
-        syslog(LOG_ERR, "Failed to read from LDC1101 register %d: %s\n", reg, strerror(errno));
-        return -1; // Error
-    }
-    return 0; 
+int send_stop(void) {
+    if (use_sim) {
+        ldc_sim_frame(&sim, stop_values, CMD_SIZE/2);
+    }
+    if (use_group) {
+        return UDP_group_send(stop_frame) > 0 ? 0 : -1;
+    }
+    return UDP_send(stop_frame) > 0 ? 0 : -1;
 }
 
 /**
- * @brief Function to initialize the LDC1101 sensor and collect data.
+ * @brief Send the command that puts the actuator where cmd_val would without
+ * hysteresis, cmd_val itself when no compensation is loaded
+ * @param cmd_val command value on the hysteresis-free line
+ * @return status: 0 on success, -1 on failure
  */
-int ldc1101_init(void){
-    uint8_t reg = 0;
-    uint8_t value =0;
-    uint8_t data[2] = {0}; 
-    uint8_t length = 0; 
-    int ret_val = 0;
-
-    spi_fd = wiringPiSPIxSetupMode(spi_num, spi_chan, SPI_SPEED, SPI_MODE_3);
-    syslog(LOG_INFO, "spi_fd: %d\n", spi_fd);
-
-    if(spi_fd==-1) {
-        syslog(LOG_ERR,"Failed to initialize SPI peripheral: %s\n", strerror(errno));
-        exit(EXIT_FAILURE);
+int send_position(int16_t cmd_val) {
+    if (compensator == NULL) {
+        return send_command(cmd_val);
     }
+    double x = round(hyst_inverse(compensator, cmd_val));
+    return send_command(x > INT16_MAX ? INT16_MAX : x < INT16_MIN ? INT16_MIN : (int16_t)x);
+}
 
-    syslog(LOG_INFO, "SPI peripheral initialized.\n");
-    // LDC1101 initialization
-    // Disable Rp calculation for cleaner LHR measurement
-    reg = LDC1101_ALT_CONFIG;
-    value = LOPTIMAL; 
-    ldc1101_set_reg(reg, value); 
-
-    reg = LDC1101_D_CONF;
-    value = DOK_REPORT; // 
-    ldc1101_set_reg(reg, value);
-
-    // Set RCOUNT MSB and LSB
-    uint16_t rcount = 0xffff;
-    reg = LDC1101_LHR_RCOUNT_MSB;
-    value = (rcount >> 8) & 0xFF; // MSB
-    ldc1101_set_reg(reg, value);
-
-    reg = LDC1101_LHR_RCOUNT_LSB;
-    value = rcount & 0xFF; // LSB
-    ldc1101_set_reg(reg, value);
-
-    // Set RP to adjust the amplitude of the oscillation
-    uint8_t rpmin = 0x07; // lower three digits
-    uint8_t rpmin_mask = 0x07;
-    uint8_t rpmax = 0x00; // upper three digits (see datasheet, Table 4 for details) )
-    uint8_t rpmax_mask = 0x70;
-    uint8_t reserved = ~(0x08); // Reserved bits set to 0
-    uint8_t rp_value = (HIGH_Q_SENSOR| ((rpmax<<4) & rpmax_mask) | (rpmin & rpmin_mask)) & reserved; // Combine RP_MAX and RP_MIN 
-    reg = LDC1101_RP_SET;
-    ldc1101_set_reg(reg, rp_value);
-
-    // Verify device ID
-    reg = LDC1101_CHIP_ID;
-    data[0] = reg;
-    length = sizeof(data);
-    ret_val=ldc1101_read_reg(reg, data, length); // Read the device ID
-    if(ret_val == -1) {
-        syslog(LOG_ERR, "Failed to read LDC1101 device ID: %s\n", strerror(errno));
-        exit(EXIT_FAILURE); // Exit on error
-    }
-
-    if(data[1]!= SPI_DEV_ID) { // Check if device ID matches expected value
-        syslog(LOG_ERR, "Unexpected Device ID: 0x%02X, expected: 0x%02X\n", data[1], SPI_DEV_ID);
-        exit(EXIT_FAILURE);
-    } else {
-        syslog(LOG_INFO, "LDC1101 Device ID: 0x%02X verified\n", data[1]);
+/**
+ * @brief Record a detected event and the stop that answered it
+ * @param log_fd log file descriptor, receives a '#' tag line
+ * @param c detector state at the alarm
+ * @param dir +1 for an upward change, -1 for a downward one
+ * @param step sweep step the event happened in
+ * @param code code that raised the alarm
+ * @param t_read_ns time that code was read, on the log's time base
+ * @param t_sent time the stop frame had been sent
+ * @param sent send_stop() status
+ * @return status: 0 on success, -1 on failure
+ */
+int log_event(int log_fd, const struct cusum *c, int dir, int step, uint32_t code, int64_t t_read_ns,
+              struct timespec t_sent, int sent){
+    char tag[160];
+    double latency_us = ((int64_t)t_sent.tv_sec * 1000000000 + t_sent.tv_nsec - t_read_ns) * 1e-3;
+    int delay = c->n - c->onset; // samples from the estimated change to the alarm
+
+    syslog(sent == 0 ? LOG_WARNING : LOG_ERR, "Event in step %d: code %u %s by %.1f sigma, %d samples after "
+           "the change; stop at %d %s %.1f us after the read", step, code, dir > 0 ? "up" : "down",
+           (code - c->mean) / cusum_sigma(c) * dir, delay, stop_values[0], sent == 0 ? "sent" : "FAILED",
+           latency_us);
+    syslog(LOG_INFO, "metric event step=%d dir=%d delay=%d latency_us=%.1f sent=%d", step, dir, delay,
+           latency_us, sent == 0);
+    int length = sprintf(tag, "# %ld.%09ld, event dir=%d step=%d code=%u mean=%.1f sigma=%.1f delay=%d "
+                         "latency_us=%.1f stop=%s\n", t_sent.tv_sec, t_sent.tv_nsec, dir, step, code, c->mean,
+                         cusum_sigma(c), delay, latency_us, sent == 0 ? "sent" : "failed");
+    return write(log_fd, tag, length) == -1 ? -1 : 0;
+}
+
+/**
+ * @brief Write a mode change tag into the data log
+ * @param log_fd log file descriptor
+ * @param ra adaptive RCOUNT state after the change
+ * @param t elapsed time of the change
+ * @return status: 0 on success, -1 on failure
+ */
+int log_rcount_mode(int log_fd, const struct rcount_adapt *ra, struct timespec t){
+    char tag[80];
+    int length = sprintf(tag, "# %ld.%09ld, rcount=0x%04X mode=%s\n", t.tv_sec, t.tv_nsec,
+                         rcount_adapt_rcount(ra), rcount_mode_name(ra->mode));
+    syslog(LOG_INFO, "RCOUNT 0x%04X (%s)", rcount_adapt_rcount(ra), rcount_mode_name(ra->mode));
+    return write(log_fd, tag, length) == -1 ? -1 : 0;
+}
+
+/**
+ * @brief Copy pending system monitor events into the data log as tag lines
+ * @param log_fd log file descriptor
+ * @return status: 0 on success, -1 on failure
+ */
+int log_sysmon_events(int log_fd){
+    struct sysmon_event ev;
+    char tag[128];
+    while (sysmon_next_event(&ev)) {
+        int length = snprintf(tag, sizeof(tag), "# %.9f, sysmon %s\n", ev.t, ev.text);
+        if (write(log_fd, tag, length) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Return to the reference command and add its mean code to the drift model
+ * @param d drift model
+ * @param ref_cmd reference command
+ * @param log_fd log file descriptor, receives a '#' tag line
+ * @param start_time t0 of the log timestamps
+ * @return status: 0 on success, -1 on failure
+ */
+int drift_revisit(struct drift_track *d, int16_t ref_cmd, int log_fd, struct timespec start_time){
+    struct step_stats ref;
+    struct timespec now;
+    uint32_t value = 0;
+    uint8_t lhr_status = 0;
+
+    if (send_position(ref_cmd) == -1) {
+        return -1;
+    }
+    usleep(DRIFT_SETTLE_US);
+    step_stats_init(&ref, -1, ref_cmd);
+    for (int i = 0; i < DRIFT_REVISIT_SAMPLES; i++) {
+        if (ldc1101_read_value(&ldc, &value, &lhr_status) == -1) {
+            syslog(LOG_ERR, "Failed to read value: %s\n", strerror(errno));
+            continue;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        now = get_elapsed_time(start_time, now);
+        step_stats_add(&ref, now.tv_sec + now.tv_nsec * 1e-9, value);
+    }
+    if (ref.n == 0) {
+        return -1;
+    }
+    drift_add_point(d, ref.mean_t, ref.mean_y);
+
+    char tag[120];
+    int length = sprintf(tag, "# %ld.%09ld, revisit cmd=%d mean=%.1f drift=%.1f rate=%.3f\n", now.tv_sec, now.tv_nsec,
+                         ref_cmd, ref.mean_y, drift_offset(d, ref.mean_t), drift_rate(d));
+    syslog(LOG_INFO, "Drift revisit %d: mean %.1f, drift %.1f codes, %.3f codes/s", d->num_points,
+           ref.mean_y, drift_offset(d, ref.mean_t), drift_rate(d));
+    return write(log_fd, tag, length) == -1 ? -1 : 0;
+}
+
+/**
+ * @brief Seconds elapsed since start_time
+ */
+double elapsed_s(struct timespec start_time){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    now = get_elapsed_time(start_time, now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Read one conversion without waiting forever on a stuck DRDY
+ * @param failures consecutive failed reads so far, reset by a good one
+ * @return 1 on a sample, 0 on a failed read, -1 once READ_FAILURES_MAX reads in a row failed
+ */
+static int read_bounded(uint32_t *value, int *failures){
+    struct ldc1101_sample s;
+    int timeout_ms = (int)(READ_TIMEOUT_CONVERSIONS * ldc1101_conversion_time(&ldc, ldc.rcount) * 1000) + 1;
+
+    if (ldc1101_read_samples(&ldc, &s, 1, timeout_ms) == 1) {
+        *value = s.code;
+        *failures = 0;
+        return 1;
+    }
+    if (++*failures < READ_FAILURES_MAX) {
+        return 0;
+    }
+    syslog(LOG_ERR, "No conversion from the LDC1101 in %d reads", *failures);
+    return -1;
+}
+
+/**
+ * @brief Relay-feedback auto-tune of the rig's controller
+ * @param rig rig id, selects the configuration file
+ * @param rule PID tuning rule
+ * @param center command the relay switches around, the rig must be settled there
+ * @param amplitude relay amplitude in command units
+ * @param max_cmd largest command magnitude the step test may send
+ * @param log_fd log file descriptor, receives the samples and '#' tag lines
+ * @param start_time t0 of the log timestamps
+ * @return status: 0 if the gains passed the step test and were saved, -1 otherwise
+ * @note Identifies the ultimate gain and period, derives the gains and checks
+ * them with a closed-loop step of half the open-loop probe response.
+ */
+int autotune_rig(const char *rig, enum pid_rule rule, int16_t center, int16_t amplitude,
+                 int16_t max_cmd, int log_fd, struct timespec start_time){
+    struct autotune at;
+    struct pid_gains gains;
+    struct pid pid;
+    struct step_check check;
+    struct rig_config cfg;
+    char path[160];
+    char line[80];
+    uint32_t value = 0;
+    int failures = 0;
+    int ret = 0;
+    int16_t cmd = center;
+    double t = elapsed_s(start_time);
+
+    syslog(LOG_INFO, "Auto-tune: relay %d +/- %d, %s rule", center, amplitude, pid_rule_name(rule));
+    autotune_init(&at, center, amplitude, t);
+    while (at.state != AUTOTUNE_DONE && at.state != AUTOTUNE_FAILED) {
+        // a dead sensor must not leave the actuator at the relay amplitude
+        if ((ret = read_bounded(&value, &failures)) != 1) {
+            if (ret == -1) {
+                break;
+            }
+            continue;
+        }
+        t = elapsed_s(start_time);
+        int length = sprintf(line, "%.9f, %d\n", t, value);
+        if ((ret = write(log_fd, line, length)) == -1) {
+            break;
+        }
+        int16_t next = autotune_sample(&at, t, value);
+        if (next != cmd && send_command(next) == 0) {
+            cmd = next;
+        }
+    }
+    send_command(center);
+    if (ret == -1) {
+        syslog(LOG_ERR, "Auto-tune aborted, actuator returned to %d", center);
+        return -1;
+    }
+    if (at.state == AUTOTUNE_FAILED) {
+        syslog(LOG_ERR, "Auto-tune failed: %s", at.sign == 0 ? "no response to the probe step" : "no limit cycle");
+        return -1;
+    }
+    autotune_gains(&at, rule, &gains);
+    syslog(LOG_INFO, "Auto-tune: Ku %.4g, Tu %.4f s -> Kp %.4g Ki %.4g Kd %.4g", at.ku, at.tu,
+           gains.kp, gains.ki, gains.kd);
+
+    // closed-loop step test, output is the command offset from the center
+    double limit = 4.0 * amplitude;
+    if (limit > max_cmd - abs(center)) {
+        limit = max_cmd - abs(center);
+    }
+    double target = at.setpoint + at.probe_delta / 2;
+    double duration = 10 * at.tu > 1.0 ? 10 * at.tu : 1.0;
+    double t0 = elapsed_s(start_time), t_prev = t0;
+    pid_init(&pid, &gains, -limit, limit);
+    step_check_init(&check, at.setpoint, target, t0);
+    int length = sprintf(line, "# %.9f, step test %.1f -> %.1f\n", t0, at.setpoint, target);
+    if (write(log_fd, line, length) == -1) {
+        return -1;
+    }
+    for (t = t0; t - t0 < duration; t_prev = t) {
+        if ((ret = read_bounded(&value, &failures)) != 1) {
+            if (ret == -1) {
+                break;
+            }
+            continue;
+        }
+        t = elapsed_s(start_time);
+        length = sprintf(line, "%.9f, %d\n", t, value);
+        if ((ret = write(log_fd, line, length)) == -1) {
+            break;
+        }
+        step_check_sample(&check, t, value);
+        int16_t next = center + (int16_t)lround(pid_update(&pid, target, value, t - t_prev));
+        if (next != cmd && send_command(next) == 0) {
+            cmd = next;
+        }
+    }
+    send_command(center);
+    if (ret == -1) {
+        syslog(LOG_ERR, "Auto-tune step test aborted, actuator returned to %d", center);
+        return -1;
+    }
+
+    double overshoot = 0, settle_s = 0;
+    if (!step_check_result(&check, t, &overshoot, &settle_s)) {
+        syslog(LOG_ERR, "Auto-tune step test failed: overshoot %.0f%%, %s", overshoot * 100,
+               settle_s < 0 ? "did not settle" : "settled");
+        return -1;
+    }
+    syslog(LOG_INFO, "Auto-tune step test: overshoot %.0f%%, settled in %.3f s", overshoot * 100, settle_s);
+
+    // keep any other settings of the rig, replace the controller section
+    rig_config_init(&cfg, rig);
+    if (rig_config_path(path, sizeof(path), cfg.rig) == -1) {
+        return -1;
+    }
+    if (rig_config_load(path, &cfg) == -1 && errno != ENOENT) {
+        syslog(LOG_WARNING, "Failed to read rig configuration %s: %s", path, strerror(errno));
+    }
+    cfg.kp = gains.kp;
+    cfg.ki = gains.ki;
+    cfg.kd = gains.kd;
+    strncpy(cfg.rule, pid_rule_name(rule), sizeof(cfg.rule) - 1);
+    cfg.ku = at.ku;
+    cfg.tu = at.tu;
+    cfg.center_cmd = center;
+    cfg.relay_amp = amplitude;
+    cfg.plant_gain = at.probe_delta / amplitude;
+    cfg.tuned = time(NULL);
+    if (rig_config_save(path, &cfg) == -1) {
+        return -1;
+    }
+    syslog(LOG_INFO, "Controller gains saved to %s", path);
+    return 0;
+}
+
+/**
+ * @brief Closed-loop step with the command updated faster than the sensor converts
+ * @param rig rig id, its tuned gains and plant gain are used
+ * @param rate_hz command update rate
+ * @param center command the rig is settled at
+ * @param max_cmd largest command magnitude the controller may send
+ * @param log_fd log file descriptor, receives the samples and '#' tag lines
+ * @param start_time t0 of the log timestamps
+ * @return status: 0 if the step response passed, -1 otherwise
+ * @note Same step as the auto-tune check: half the probe response.
+ */
+int multirate_step(const char *rig, double rate_hz, int16_t center, int16_t max_cmd,
+                   int log_fd, struct timespec start_time){
+    static struct mrc mrc;
+    struct rig_config cfg;
+    struct step_stats base;
+    struct step_check check;
+    char path[160];
+    char line[120];
+    uint32_t value = 0;
+    uint8_t lhr_status = 0;
+    double t;
+
+    rig_config_init(&cfg, rig);
+    if (rig_config_path(path, sizeof(path), cfg.rig) == -1 || rig_config_load(path, &cfg) == -1 ||
+        cfg.tuned == 0 || cfg.plant_gain == 0) {
+        syslog(LOG_ERR, "Rig %s has no tuned controller, run -T first", cfg.rig);
+        return -1;
+    }
+    struct pid_gains gains = {cfg.kp, cfg.ki, cfg.kd};
+    double t_conv = ldc1101_conversion_time(&ldc, ldc.rcount);
+
+    // the code at the center command is the starting estimate
+    step_stats_init(&base, -1, center);
+    for (double t_start = t = elapsed_s(start_time); t - t_start < AUTOTUNE_SETTLE_S || base.n < 3; ) {
+        if (ldc1101_read_value(&ldc, &value, &lhr_status) == -1) {
+            return -1;
+        }
+        t = elapsed_s(start_time);
+        step_stats_add(&base, t, value);
+    }
+
+    double limit = 4.0 * cfg.relay_amp;
+    if (limit > max_cmd - abs(center)) {
+        limit = max_cmd - abs(center);
+    }
+    double target = base.mean_y + cfg.plant_gain * cfg.relay_amp / 2;
+    double duration = 10 * cfg.tu > 1.0 ? 10 * cfg.tu : 1.0;
+    double t0 = elapsed_s(start_time);
+    mrc_init(&mrc, &gains, limit, center, cfg.plant_gain, cfg.plant_tau_ms * 1e-3, base.mean_y, t0);
+    mrc_set_target(&mrc, target);
+    step_check_init(&check, base.mean_y, target, t0);
+    int length = sprintf(line, "# %.9f, multirate step %.1f -> %.1f, %.0f Hz commands, %.1f Hz conversions\n",
+                         t0, base.mean_y, target, rate_hz, 1 / t_conv);
+    if (write(log_fd, line, length) == -1 || mrc_start(&mrc, rate_hz, start_time, send_command) == -1) {
+        return -1;
+    }
+    for (t = t0; t - t0 < duration; ) {
+        if (ldc1101_read_value(&ldc, &value, &lhr_status) == -1) {
+            continue;
+        }
+        t = elapsed_s(start_time);
+        double estimate = mrc_measure(&mrc, t, t_conv, value);
+        step_check_sample(&check, t, value);
+        length = sprintf(line, "%.9f, %d, %.1f\n", t, value, estimate);
+        if (write(log_fd, line, length) == -1) {
+            break;
+        }
+    }
+    mrc_stop(&mrc);
+    send_command(center);
+
+    double overshoot = 0, settle_s = 0;
+    int ok = step_check_result(&check, t, &overshoot, &settle_s);
+    syslog(LOG_INFO, "Multi-rate step: %lu command updates for %lu conversions (%lu late), "
+           "overshoot %.0f%%, %s %.3f s", mrc.updates, mrc.corrections, mrc.late, overshoot * 100,
+           settle_s < 0 ? "did not settle in" : "settled in", settle_s < 0 ? duration : settle_s);
+    length = sprintf(line, "# %.9f, multirate updates=%lu conversions=%lu overshoot=%.3f settle=%.3f\n",
+                     t, mrc.updates, mrc.corrections, overshoot, settle_s);
+    if (write(log_fd, line, length) == -1) {
+        return -1;
+    }
+    return ok ? 0 : -1;
+}
+
+/**
+ * @brief Repeat the sweep plan, learning a feedforward command table between repetitions
+ * @param rig rig id, its plant gain is used and its table is loaded and saved
+ * @param reps repetitions to run
+ * @param learn learning gain
+ * @param start_cmd command of the baseline step
+ * @param cmd_inc command increment between steps
+ * @param num_steps steps per repetition
+ * @param num_samples samples per step
+ * @param max_cmd largest command magnitude that may be sent
+ * @param log_fd log file descriptor, receives the samples and '#' tag lines
+ * @param start_time t0 of the log timestamps
+ * @return status: 0 on success, -1 on failure
+ */
+int ilc_sweep(const char *rig, int reps, double learn, int16_t start_cmd, int16_t cmd_inc, int num_steps,
+              int num_samples, int16_t max_cmd, int log_fd, struct timespec start_time){
+    struct rig_config cfg;
+    struct ilc il;
+    struct step_stats base;
+    char path[160];
+    char line[120];
+    uint32_t value = 0;
+    uint8_t lhr_status = 0;
+    int ret = 0;
+
+    rig_config_init(&cfg, rig);
+    if (rig_config_path(path, sizeof(path), cfg.rig) == -1 || rig_config_load(path, &cfg) == -1 ||
+        cfg.plant_gain == 0) {
+        syslog(LOG_ERR, "Rig %s has no plant gain, run -T first", cfg.rig);
+        return -1;
+    }
+    // the plan must fit in the command range before any feedforward is added
+    int last = start_cmd + (num_steps - 1) * cmd_inc;
+    if (abs(start_cmd) > max_cmd || abs(last) > max_cmd) {
+        syslog(LOG_ERR, "The sweep %d..%d exceeds the command limit %d", start_cmd, last, max_cmd);
+        return -1;
+    }
+    if (ilc_init(&il, num_steps, num_samples, learn, cfg.plant_gain) == -1 ||
+        ilc_path(path, sizeof(path), cfg.rig) == -1) {
+        ilc_free(&il);
+        return -1;
+    }
+    if (ilc_load(&il, path) == 0) {
+        syslog(LOG_INFO, "ILC table of %d repetitions loaded from %s", il.reps, path);
+    }
+    syslog(LOG_INFO, "ILC: %d repetitions of %d steps x %d samples, learning gain %.2f",
+           reps, num_steps, num_samples, learn);
+
+    for (int rep = 0; rep < reps && ret == 0; rep++) {
+        // each repetition is referenced to its own baseline, so slow drift is not learned
+        send_command(start_cmd);
+        step_stats_init(&base, -1, start_cmd);
+        for (double t_start = elapsed_s(start_time), t = t_start; t - t_start < AUTOTUNE_SETTLE_S || base.n < 3; ) {
+            if (ldc1101_read_value(&ldc, &value, &lhr_status) == -1) {
+                ret = -1;
+                break;
+            }
+            t = elapsed_s(start_time);
+            step_stats_add(&base, t, value);
+        }
+        ilc_set_reference(&il, base.mean_y, cmd_inc);
+        int length = sprintf(line, "# %.9f, ilc repetition %d baseline %.1f\n", elapsed_s(start_time),
+                             il.reps + 1, base.mean_y);
+        if (ret == -1 || write(log_fd, line, length) == -1) {
+            ret = -1;
+            break;
+        }
+
+        int16_t cmd = start_cmd;
+        for (int k = 0; k < num_steps && ret == 0; k++) {
+            for (int i = 0; i < num_samples; i++) {
+                long next = start_cmd + k * cmd_inc + lround(ilc_command(&il, k, i));
+                next = next > max_cmd ? max_cmd : next < -max_cmd ? -max_cmd : next;
+                if (next != cmd && send_command((int16_t)next) == 0) {
+                    cmd = (int16_t)next;
+                }
+                if (ldc1101_read_value(&ldc, &value, &lhr_status) == -1) {
+                    continue;
+                }
+                double t = elapsed_s(start_time);
+                length = sprintf(line, "%.9f, %d\n", t, value);
+                if (write(log_fd, line, length) == -1) {
+                    ret = -1;
+                    break;
+                }
+                ilc_record(&il, k, i, value);
+            }
+        }
+        if (ret == -1) {
+            break;
+        }
+        ilc_update(&il, max_cmd);
+        syslog(LOG_INFO, "ILC repetition %d: tracking error rms %.1f, max %.1f codes", il.reps, il.rms, il.max);
+        syslog(LOG_INFO, "metric ilc rep=%d rms=%.3f max=%.3f", il.reps, il.rms, il.max);
+        length = sprintf(line, "# %.9f, ilc rep=%d rms=%.3f max=%.3f\n", elapsed_s(start_time), il.reps,
+                         il.rms, il.max);
+        if (write(log_fd, line, length) == -1) {
+            ret = -1;
+        }
+    }
+    send_command(start_cmd);
+    if (il.reps > 0 && ilc_save(&il, path) == 0) {
+        syslog(LOG_INFO, "ILC table saved to %s", path);
+    }
+    ilc_free(&il);
+    return ret;
+}
+
+/**
+ * @brief Settled mean code at a command: the second half of num_samples samples
+ * @return the mean, NAN on failure
+ */
+double settled_code(int16_t cmd, int num_samples, int log_fd, struct timespec start_time){
+    char line[80];
+    uint32_t value = 0;
+    uint8_t lhr_status = 0;
+    double sum = 0;
+    int n = 0;
+
+    if (send_command(cmd) == -1) {
+        return NAN;
+    }
+    for (int i = 0; i < num_samples; i++) {
+        if (ldc1101_read_value(&ldc, &value, &lhr_status) == -1) {
+            continue;
+        }
+        int length = sprintf(line, "%.9f, %d\n", elapsed_s(start_time), value);
+        if (write(log_fd, line, length) == -1) {
+            return NAN;
+        }
+        if (i >= num_samples / 2) {
+            sum += value;
+            n++;
+        }
+    }
+    return n > 0 ? sum / n : NAN;
+}
+
+/**
+ * @brief Identify the actuator hysteresis from up and down sweeps of the plan
+ * @param rig rig id, the model is saved as its .hyst file
+ * @param cycles up/down sweeps, each reversing lower than the last so minor loops are seen too
+ * @param start_cmd command of the baseline step, the sweeps turn back there
+ * @param cmd_inc command increment between steps
+ * @param num_steps steps of the full sweep
+ * @param num_samples samples per step, the second half is averaged
+ * @param max_cmd largest command magnitude that may be sent
+ * @param log_fd log file descriptor, receives the samples and '#' tag lines
+ * @param start_time t0 of the log timestamps
+ * @return status: 0 on success, -1 on failure
+ */
+int hysteresis_fit(const char *rig, int cycles, int16_t start_cmd, int16_t cmd_inc, int num_steps,
+                   int num_samples, int16_t max_cmd, int log_fd, struct timespec start_time){
+    char path[160];
+    char line[120];
+
+    int last = start_cmd + (num_steps - 1) * cmd_inc;
+    if (num_steps < 2 || abs(start_cmd) > max_cmd || abs(last) > max_cmd) {
+        syslog(LOG_ERR, "The sweep %d..%d does not fit in the command limit %d", start_cmd, last, max_cmd);
+        return -1;
+    }
+    hyst_init(&hyst, (double)(num_steps - 1) * cmd_inc, start_cmd);
+    syslog(LOG_INFO, "Hysteresis fit: %d up/down sweeps of up to %d steps", cycles, num_steps - 1);
+    double y = settled_code(start_cmd, num_samples, log_fd, start_time);
+    for (int c = 0; c < cycles && !isnan(y); c++) {
+        int top = (num_steps - 1) * (cycles - c) / cycles;
+        top = top > 0 ? top : 1;
+        // every sweep starts where the last one ended, at the baseline
+        for (int k = c == 0 ? 0 : 1; k <= 2 * top; k++) {
+            int16_t cmd = start_cmd + (k <= top ? k : 2 * top - k) * cmd_inc;
+            if (k > 0) {
+                y = settled_code(cmd, num_samples, log_fd, start_time);
+            }
+            int length = sprintf(line, "# %.9f, hysteresis cycle %d cmd=%d code=%.1f\n", elapsed_s(start_time),
+                                 c, cmd, y);
+            if (isnan(y) || write(log_fd, line, length) == -1) {
+                return -1;
+            }
+            hyst_fit_add(&hyst, cmd, y);
+        }
+    }
+    send_command(start_cmd);
+    if (isnan(y) || hyst_fit(&hyst) == -1) {
+        return -1;
+    }
+
+    double width = 0;
+    for (int i = 0; i < HYST_OPERATORS; i++) {
+        width += 2 * hyst.a[i] * hyst.r[i]; // loop width of a full sweep, command units
+    }
+    syslog(LOG_INFO, "Hysteresis model: %.3f codes/cmd, loop width %.1f cmd, fit rms %.1f codes, "
+           "straight line %.1f codes", hyst.gain, width, hyst.rms, hyst.rms_linear);
+    syslog(LOG_INFO, "metric hysteresis gain=%.6f width=%.3f rms=%.3f rms_linear=%.3f", hyst.gain, width,
+           hyst.rms, hyst.rms_linear);
+    if (hyst_path(path, sizeof(path), rig) == -1 || hyst_save(&hyst, path) == -1) {
+        return -1;
+    }
+    syslog(LOG_INFO, "Hysteresis model saved to %s, use it with -Y on", path);
+    return 0;
+}
+
+/**
+ * @brief Identify every channel's influence on the sensor in parallel
+ * @param cycles Hadamard cycles to run, two or more give standard errors
+ * @param center command all channels are perturbed around, the rig must be settled there
+ * @param amplitude perturbation in command units
+ * @param num_samples samples averaged per pattern
+ * @param max_cmd largest command magnitude any channel may be sent
+ * @param log_fd log file descriptor, receives the samples and '#' tag lines
+ * @param start_time t0 of the log timestamps
+ * @param out_path JSON file receiving the coefficients
+ * @return status: 0 on success, -1 on failure
+ */
+int identify_influence(int cycles, int16_t center, int16_t amplitude, int num_samples, int16_t max_cmd,
+                       int log_fd, struct timespec start_time, const char *out_path){
+    struct hadamard_id h;
+    int16_t values[CMD_SIZE/2];
+    char line[80];
+    uint32_t value = 0;
+    uint8_t lhr_status = 0;
+
+    // every channel swings to both center + amplitude and center - amplitude
+    if (amplitude <= 0 || abs(center) + amplitude > max_cmd) {
+        syslog(LOG_ERR, "Influence patterns %d +/- %d exceed the command limit %d", center, amplitude, max_cmd);
+        return -1;
+    }
+    if (hadamard_id_init(&h, CMD_SIZE/2, center, amplitude) == -1) {
+        return -1;
+    }
+    syslog(LOG_INFO, "Influence identification: %d channels, %d patterns x %d cycles, %d +/- %d",
+           h.channels, HADAMARD_ORDER, cycles, center, amplitude);
+    while (h.cycles < cycles) {
+        hadamard_pattern(&h, values);
+        if (send_command_frame(values) == -1) {
+            return -1;
+        }
+        usleep(HADAMARD_SETTLE_US);
+        double t = elapsed_s(start_time);
+        int length = sprintf(line, "# %.9f, pattern %d cycle %d\n", t, h.pattern, h.cycles);
+        if (write(log_fd, line, length) == -1) {
+            return -1;
+        }
+        double sum = 0;
+        int n = 0;
+        for (int i = 0; i < num_samples; i++) {
+            if (ldc1101_read_value(&ldc, &value, &lhr_status) == -1) {
+                continue;
+            }
+            t = elapsed_s(start_time);
+            length = sprintf(line, "%.9f, %d\n", t, value);
+            if (write(log_fd, line, length) == -1) {
+                return -1;
+            }
+            sum += value;
+            n++;
+        }
+        if (n == 0) {
+            return -1;
+        }
+        if (hadamard_id_add(&h, sum / n)) {
+            int top = 0;
+            for (int j = 1; j < h.channels; j++) {
+                if (fabs(h.mean[j]) > fabs(h.mean[top])) {
+                    top = j;
+                }
+            }
+            syslog(LOG_INFO, "Influence cycle %d: strongest channel %d, %.3f +/- %.3f codes/cmd", h.cycles,
+                   top, h.mean[top], hadamard_stderr(&h, top));
+        }
     }
+    send_command(center);
 
-    // Start the LDC1101 
-    reg = LDC1101_START_CONFIG;
-    value = 0; // writing 0 to START_CONFIG initiates the chip conversion
-    ldc1101_set_reg(reg, value); 
+    FILE *f = fopen(out_path, "w");
+    if (f == NULL) {
+        syslog(LOG_ERR, "Failed to open %s: %s", out_path, strerror(errno));
+        return -1;
+    }
+    fprintf(f, "{\n  \"cycles\": %d,\n  \"patterns\": %d,\n  \"center\": %d,\n  \"amplitude\": %d,\n"
+            "  \"common\": %.3f,\n  \"channels\": [\n", h.cycles, HADAMARD_ORDER, center, amplitude, h.common);
+    for (int j = 0; j < h.channels; j++) {
+        fprintf(f, "    {\"channel\": %d, \"coef\": %.6f, \"stderr\": %.6f}%s\n", j, h.mean[j],
+                hadamard_stderr(&h, j), j + 1 < h.channels ? "," : "");
+        syslog(LOG_INFO, "metric influence channel=%d coef=%.6f stderr=%.6f", j, h.mean[j], hadamard_stderr(&h, j));
+    }
+    fprintf(f, "  ]\n}\n");
+    if (fclose(f) != 0) {
+        syslog(LOG_ERR, "Failed to write %s: %s", out_path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
 
-    return 0; // Success
+/**
+ * @brief Switch the running capture to a newly published configuration
+ * @param live new configuration version
+ * @param sw running sweep, its plan and adaptive RCOUNT state are updated
+ * @param num_samples samples per step, updated
+ * @param log_fd log file descriptor, receives a '#' tag line
+ * @param sample_index samples logged so far: the next sample is the first with the new settings
+ * @param start_time t0 of the log timestamps
+ * @return status: 0 on success, -1 on failure
+ */
+int apply_live_config(const struct live_config *live, struct sweep *sw, int *num_samples,
+                      int log_fd, unsigned long sample_index, struct timespec start_time){
+    const struct rig_config *cfg = &live->cfg;
+    char tag[160];
+
+    sw->plan.hires_rcount = cfg->rcount;
+    sw->plan.fast_rcount = cfg->fast_rcount;
+    sw->plan.slope_thresh = cfg->slope_thresh;
+    sw->adapt.hires_rcount = cfg->rcount;
+    sw->adapt.fast_rcount = cfg->fast_rcount;
+    sw->adapt.slope_thresh = cfg->slope_thresh;
+    if (sweep_rcount(sw) != ldc.rcount) {
+        ldc1101_set_rcount(&ldc, sweep_rcount(sw));
+        sysmon_rate_reset(); // the conversion time changes
+    }
+    *num_samples = cfg->num_samples;
+    if ((sw->plan.drift_every > 0) == (cfg->drift_every > 0)) {
+        sw->plan.drift_every = cfg->drift_every;
+    } else {
+        // the log's column layout was fixed when the run started
+        syslog(LOG_WARNING, "Config version %lu: drift tracking cannot be switched on or off mid-run", live->gen);
+    }
+
+    int length = snprintf(tag, sizeof(tag), "# %.9f, config version=%lu sample=%lu rcount=0x%04X fast=0x%04X "
+                          "slope=%.0f samples=%d drift_every=%d\n", elapsed_s(start_time), live->gen, sample_index,
+                          cfg->rcount, cfg->fast_rcount, cfg->slope_thresh, cfg->num_samples, sw->plan.drift_every);
+    syslog(LOG_INFO, "Config version %lu in effect from sample %lu", live->gen, sample_index);
+    return write(log_fd, tag, length) == -1 ? -1 : 0;
 }
 
 int main(int argc, char *argv[]) {
@@ -193,10 +857,8 @@ int main(int argc, char *argv[]) {
     // private variables 
     int opt = 0; // option for command line argument parsing
     uint32_t value = 0; // Variable to hold measurement value
-    uint8_t reg = 0; // Register address for LDC1101
-    uint8_t status = 0; // Variable to hold status register value
     int ret = 0; // Return value for function calls
-    char logfile[50] = "./testing/ldc1101_log.csv"; // default logfile name
+    char logfile[50] = ""; // default: ./testing/ldc1101_<start time>.csv, so runs are never overwritten
     int log_fd = -1; // File descriptor for log file
     int num_samples = 500; // default number of samples to read
     int num_steps = 1; // Number of steps for command value increment
@@ -205,16 +867,69 @@ int main(int argc, char *argv[]) {
     struct timespec start_time; // t0
     struct timespec current_time; // t 
     struct timespec elapsed_time; // Timestamp for datalogging (t - t0)
-    int16_t cmd_val = 0;
     int16_t max_cmd = 24000; // Maximum command value
+    int adaptive = 0; // 1 to switch RCOUNT between fast and hires modes
+    uint16_t fast_rcount = RCOUNT_FAST_DEFAULT;
+    double slope_thresh = RCOUNT_SLOPE_DEFAULT;
+    char *endp = NULL;
+    long arg = 0; // numeric option value, range checked before it is narrowed
+    static struct sweep sweep; // sweep plan, per-step statistics and run summary
+    struct sweep_plan plan;
+    int revisit = 0; // 1 when a drift revisit is due
+    char summary_file[80];
+    double t_sample = 0; // elapsed time of the sample, s
+    char *tuning_spec = NULL; // -L low-latency socket profile
+    struct UDP_tuning tuning;
+    char *binfile = NULL; // -b indexed binary copy of the log
+    struct binlog_writer binlog;
+    struct timespec wall_start; // CLOCK_REALTIME at t0, stored in the binary log
+    uint8_t lhr_status = 0; // last LHR_STATUS read
+    struct ldc1101_sample batch[SAMPLE_BATCH]; // conversions read in one call
+    char *catalog_file = CATALOG_DEFAULT; // run catalog the capture is registered in
+    struct catalog_entry run_entry;
+    struct run_totals totals = {0}; // stays zero for the modes that run no sweep
+    int drift_every = 0; // -D revisit the reference command every N steps, 0 = off
+    enum drift_model drift_model = DRIFT_LINEAR;
+    int autotune = 0; // -T run the relay auto-tune instead of the sweep
+    enum pid_rule tune_rule = PID_RULE_ZN;
+    int16_t relay_amp = 0; // 0: use the command increment
+    int monitor = 0; // -M watch cpufreq/thermal/throttling, -P also pins the governor
+    int pin_governor = 0;
+    struct sysmon_stats sys_stats;
+    struct rig_config rig_cfg;
+    int influence_cycles = 0; // -H identify per-channel influence instead of the sweep
+    int16_t influence_amp = 0; // 0: use the command increment
+    int hot_reload = 0; // -W reload the rig configuration on SIGHUP
+    double control_hz = 0; // -K multi-rate closed-loop step at this command rate
+    int ilc_reps = 0; // -J repeat the sweep with iterative learning control
+    int hyst_on = 0; // -Y on: compensate the actuator hysteresis in the sweep
+    int hyst_cycles = 0; // -Y fit[:cycles]: identify the hysteresis model instead of the sweep
+    int detect = 0; // -E stop the actuator when the CUSUM detector sees a change within a step
+    double detect_h = CUSUM_H_DEFAULT;
+    int16_t stop_cmd = 0;
+    int stop_cmd_set = 0; // 0: hold the last command sent
+    struct cusum event;
+    int stopped = 0; // 1 once the detector stopped the actuator
+    double ilc_learn = ILC_LEARN_DEFAULT;
+    const struct live_config *live = NULL;
+    unsigned long sample_index = 0; // samples logged so far
+    char rig_path[160];
+    const char *jitter_cause = NULL;
+    catalog_entry_init(&run_entry);
 
     // Initialize the timer and logger 
     clock_gettime(CLOCK_MONOTONIC, &start_time); // Start time measurement
+    clock_gettime(CLOCK_REALTIME, &wall_start);
+    struct tm start_tm;
+    localtime_r(&wall_start.tv_sec, &start_tm);
+    strftime(logfile, sizeof(logfile), "./testing/ldc1101_%Y%m%d_%H%M%S.csv", &start_tm);
     openlog(NULL, LOG_PERROR, LOG_LOCAL6); // Open syslog for logging
     syslog(LOG_INFO, "Starting LDC1101 data collection program.\n");
 
+    UDP_group_init(1);
+
     // Parse command line arguments for logfile, and number of samples
-    while ((opt = getopt(argc, argv, "hn:l:v:s:")) != -1) {
+    while ((opt = getopt(argc, argv, "hn:l:v:s:t:a:L:b:R:I:C:D:T:MPSH:WK:J:Y:E:")) != -1) {
         switch(opt) {
             case 'l':
                 strncpy(logfile, optarg, sizeof(logfile) - 1); // Set logfile name
@@ -241,15 +956,159 @@ int main(int argc, char *argv[]) {
                 }
                 syslog(LOG_INFO, "Number of steps set to %d", num_steps);
                 break;
+            case 't':
+                if (UDP_group_add_spec(optarg) < 0) { // unicast or multicast host:port, repeatable
+                    exit(EXIT_FAILURE);
+                }
+                use_group = 1;
+                break;
+            case 'a':
+                // -a fast_rcount[:slope], slope in raw LHR_DATA codes/s, the same scale at any RCOUNT
+                arg = strtol(optarg, &endp, 0);
+                if (endp != optarg && *endp == ':') {
+                    slope_thresh = strtod(endp + 1, &endp);
+                }
+                if (endp == optarg || *endp != '\0' || arg <= 0 || arg >= RCOUNT_HIRES_DEFAULT ||
+                    slope_thresh <= 0) {
+                    syslog(LOG_ERR, "Adaptive mode needs 0 < fast RCOUNT < 0x%04X and a positive slope.\n", RCOUNT_HIRES_DEFAULT);
+                    exit(EXIT_FAILURE);
+                }
+                fast_rcount = (uint16_t)arg;
+                adaptive = 1;
+                syslog(LOG_INFO, "Adaptive RCOUNT: fast 0x%04X, slope threshold %.0f codes/s", fast_rcount, slope_thresh);
+                break;
+            case 'b':
+                binfile = optarg;
+                syslog(LOG_INFO, "Binary log file set to: %s\n", binfile);
+                break;
+            case 'R':
+                strncpy(run_entry.rig, optarg, sizeof(run_entry.rig) - 1);
+                break;
+            case 'I':
+                strncpy(run_entry.sensor, optarg, sizeof(run_entry.sensor) - 1);
+                break;
+            case 'C':
+                catalog_file = optarg;
+                break;
+            case 'D':
+                // -D every[:linear|piecewise]
+                drift_every = strtol(optarg, &endp, 0);
+                if (drift_every <= 0 || (*endp == ':' && drift_parse_model(endp + 1, &drift_model) == -1)) {
+                    syslog(LOG_ERR, "Drift tracking needs a positive step interval and a linear or piecewise model.\n");
+                    exit(EXIT_FAILURE);
+                }
+                syslog(LOG_INFO, "Drift revisit every %d steps, %s model", drift_every, drift_model_name(drift_model));
+                break;
+            case 'T':
+                // -T rule[:relay amplitude]
+                endp = strchr(optarg, ':');
+                if (endp != NULL) {
+                    *endp = '\0';
+                    relay_amp = atoi(endp + 1);
+                }
+                if (pid_rule_parse(optarg, &tune_rule) == -1 || relay_amp < 0) {
+                    syslog(LOG_ERR, "Auto-tune rule must be zn, pi, pessen, some, none or tl.\n");
+                    exit(EXIT_FAILURE);
+                }
+                autotune = 1;
+                break;
+            case 'P':
+                pin_governor = 1;
+                monitor = 1;
+                break;
+            case 'M':
+                monitor = 1;
+                break;
+            case 'S':
+                use_sim = 1;
+                break;
+            case 'W':
+                hot_reload = 1;
+                break;
+            case 'K':
+                control_hz = atof(optarg);
+                if (control_hz <= 0) {
+                    syslog(LOG_ERR, "Command update rate must be positive.\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'J':
+                // -J repetitions[:learning gain]
+                ilc_reps = strtol(optarg, &endp, 0);
+                if (*endp == ':') {
+                    ilc_learn = atof(endp + 1);
+                }
+                if (ilc_reps <= 0 || ilc_learn <= 0 || ilc_learn > 1) {
+                    syslog(LOG_ERR, "ILC needs a positive number of repetitions and a learning gain in (0, 1].\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'E':
+                // -E threshold[:stop command], threshold in noise sigmas
+                detect_h = strtod(optarg, &endp);
+                arg = 0;
+                if (endp != optarg && *endp == ':' && endp[1] != '\0') {
+                    arg = strtol(endp + 1, &endp, 0);
+                    stop_cmd_set = 1;
+                }
+                if (endp == optarg || *endp != '\0' || detect_h <= 0 || labs(arg) > max_cmd) {
+                    syslog(LOG_ERR, "Event detection needs a positive threshold and a stop command within +/-%d.\n",
+                           max_cmd);
+                    exit(EXIT_FAILURE);
+                }
+                stop_cmd = (int16_t)arg;
+                detect = 1;
+                break;
+            case 'Y':
+                // -Y on | fit[:cycles]
+                if (strcmp(optarg, "on") == 0) {
+                    hyst_on = 1;
+                } else if (strncmp(optarg, "fit", 3) == 0 && (optarg[3] == '\0' || optarg[3] == ':')) {
+                    hyst_cycles = optarg[3] == ':' ? atoi(optarg + 4) : HYST_FIT_CYCLES;
+                    if (hyst_cycles <= 0) {
+                        syslog(LOG_ERR, "Hysteresis fit needs a positive number of cycles.\n");
+                        exit(EXIT_FAILURE);
+                    }
+                } else {
+                    syslog(LOG_ERR, "Unknown hysteresis mode %s, use on or fit[:cycles].\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'H':
+                // -H cycles[:amplitude]
+                influence_cycles = strtol(optarg, &endp, 0);
+                long amp = 0;
+                if (*endp == ':') {
+                    amp = strtol(endp + 1, &endp, 0);
+                }
+                if (influence_cycles <= 0 || *endp != '\0' || amp < 0 || amp > INT16_MAX) {
+                    syslog(LOG_ERR, "Influence identification needs a positive number of cycles "
+                           "and an amplitude of 0..%d.\n", INT16_MAX);
+                    exit(EXIT_FAILURE);
+                }
+                influence_amp = (int16_t)amp;
+                break;
+            case 'L':
+                tuning_spec = optarg; // "all" or prio,dscp,busy,sndbuf,cpu=N
+                break;
             default:
-                fprintf(stderr, "Usage: %s [-l logfile] [-n num_samples] [-v command] [-s number of steps]\n", argv[0]);
+                fprintf(stderr, "Usage: %s [-l logfile] [-n num_samples] [-v command] [-s number of steps] [-t host:port]... [-a fast_rcount[:slope codes/s]] [-L socket tuning] [-b binary log] [-R rig id] [-I sensor id] [-C catalog] [-D every[:model]] [-T rule[:amplitude]] [-M] [-P] [-S] [-H cycles[:amplitude]] [-W] [-K command rate] [-J repetitions[:learning gain]] [-Y on|fit[:cycles]] [-E threshold[:stop command]]\n", argv[0]);
                 exit(EXIT_FAILURE);; // Exit on invalid option
         }
     }
+    if (hot_reload) {
+        // before any thread exists: the binlog writer, the monitor and the
+        // controller timers all inherit the mask, only the loader takes SIGHUP
+        hot_config_block_signal();
+    }
 
     // Initialize the UDP communication to the KASM PCB via UDP server
     int fd=0;
-    fd = UDP_init(ip, port);
+    if (use_group) {
+        fd = 0; // targets were resolved while parsing -t
+    } else {
+        fd = UDP_init(ip, port);
+    }
 
     if(fd<0){
         syslog(LOG_ERR, "Failed to get socket descriptor");
@@ -258,20 +1117,56 @@ int main(int argc, char *argv[]) {
         syslog(LOG_INFO, "UDP client initialized");
     }
 
+    if (UDP_tuning_parse(&tuning, tuning_spec) == -1) {
+        exit(EXIT_FAILURE);
+    }
+    if (tuning_spec != NULL) {
+        syslog(LOG_INFO, "Low-latency socket profile: %s", tuning_spec);
+        if (use_group) {
+            if (UDP_group_fd(AF_INET) >= 0) {
+                UDP_apply_tuning(UDP_group_fd(AF_INET), &tuning);
+            }
+            if (UDP_group_fd(AF_INET6) >= 0) {
+                UDP_apply_tuning(UDP_group_fd(AF_INET6), &tuning);
+            }
+        } else {
+            UDP_apply_tuning(fd, &tuning);
+        }
+        UDP_pin_thread(&tuning); // commands are sent from the sampling thread
+    }
+
+    if (use_sim) {
+        // the sensor model comes from the rig configuration, defaults if there is none
+        rig_config_init(&rig_cfg, run_entry.rig);
+        rig_config_path(rig_path, sizeof(rig_path), rig_cfg.rig);
+        if (rig_config_load(rig_path, &rig_cfg) == -1 && errno != ENOENT) {
+            syslog(LOG_WARNING, "Failed to read rig configuration %s: %s", rig_path, strerror(errno));
+        }
+        ldc_sim_init(&sim, &rig_cfg.sim);
+        if (run_entry.sensor[0] == '\0') {
+            strcpy(run_entry.sensor, "sim");
+        }
+        syslog(LOG_INFO, "Simulated LDC1101, model from %s", rig_path);
+    }
+
     /* Get baseline data */
-    send_command(start_value); // Send initial command value to actuater
+    if (hyst_on) {
+        // the model's operators start out settled at the baseline command
+        if (hyst_path(rig_path, sizeof(rig_path), run_entry.rig) == -1 ||
+            hyst_load(&hyst, rig_path, start_value) == -1) {
+            exit(EXIT_FAILURE);
+        }
+        compensator = &hyst;
+        syslog(LOG_INFO, "Hysteresis compensation from %s, fit rms %.1f codes (%.1f uncompensated)",
+               rig_path, hyst.rms, hyst.rms_linear);
+    }
+    send_position(start_value); // Send initial command value to actuater
     usleep(100000); // Sleep for 100ms to allow actuater to settle
 
-    // Initialize wiringPi library and get the file descriptor for SPI communication
-    wiringPiSetup();    
-    spi_fd = wiringPiSPIxSetupMode(spi_num, spi_chan, SPI_SPEED, SPI_MODE_3);
-    if(spi_fd == -1){
-        syslog(LOG_ERR,"Failed to initialize SPI peripheral: %s\n", strerror(errno));
+    if (ldc1101_open(&ldc, spi_num, spi_chan, use_sim ? &sim : NULL, RCOUNT_HIRES_DEFAULT) == -1) {
         exit(EXIT_FAILURE);
     }
-    syslog(LOG_INFO, "SPI peripheral initialized.\n");
-
-    ldc1101_init();
+    ldc.t0 = start_time; // sample timestamps on the log's time base
     syslog(LOG_INFO, "LDC1101 initialized.\n");
 
     // Open the log file for writing only, create it if non-existent, and overwrite it if it exists
@@ -280,61 +1175,290 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "Failed to open log file %s: %s\n", logfile, strerror(errno));
         return -1; // Exit if log file cannot be opened
     }
-    char log_header[] = "Timestamp, Value\n"; // Header for log file
-    if (write(log_fd, log_header, sizeof(log_header) - 1) == -1) {
+    // drift tracking adds the corrected value next to the raw one
+    const char *log_header = drift_every > 0 ? "Timestamp, Value, Corrected\n" : "Timestamp, Value\n";
+    if (write(log_fd, log_header, strlen(log_header)) == -1) {
         fprintf(stderr, "Failed to write header to log file: %s\n", strerror(errno));
         close(log_fd);
         return -1; // Exit if writing header fails
     }
  
+    if (autotune) {
+        // commissioning run: tune, save the gains and stop
+        ret = autotune_rig(run_entry.rig, tune_rule, start_value, relay_amp > 0 ? relay_amp : cmd_inc,
+                           max_cmd, log_fd, start_time);
+        close(log_fd);
+        goto done;
+    }
+    if (control_hz > 0) {
+        ret = multirate_step(run_entry.rig, control_hz, start_value, max_cmd, log_fd, start_time);
+        close(log_fd);
+        goto done;
+    }
+    if (ilc_reps > 0) {
+        ret = ilc_sweep(run_entry.rig, ilc_reps, ilc_learn, start_value, cmd_inc, num_steps, num_samples,
+                        max_cmd, log_fd, start_time);
+        close(log_fd);
+        goto done;
+    }
+    if (hyst_cycles > 0) {
+        ret = hysteresis_fit(run_entry.rig, hyst_cycles, start_value, cmd_inc, num_steps, num_samples,
+                             max_cmd, log_fd, start_time);
+        close(log_fd);
+        goto done;
+    }
+    if (influence_cycles > 0) {
+        snprintf(summary_file, sizeof(summary_file), "%s.influence.json", logfile);
+        ret = identify_influence(influence_cycles, start_value, influence_amp > 0 ? influence_amp : cmd_inc,
+                                 num_samples, max_cmd, log_fd, start_time, summary_file);
+        close(log_fd);
+        goto done;
+    }
+    if (binfile != NULL &&
+        binlog_create(&binlog, binfile, logfile, (int64_t)wall_start.tv_sec * 1000000000 + wall_start.tv_nsec) == -1) {
+        close(log_fd);
+        return -1;
+    }
+    if (binfile != NULL) {
+        // size the pool for the fastest conversions this run can make
+        uint16_t min_rcount = adaptive && fast_rcount < ldc.rcount ? fast_rcount : ldc.rcount;
+        double rate = 1 / ldc1101_conversion_time(&ldc, min_rcount);
+        if (batch_pool_init(sizeof(struct binlog_batch),
+                            batch_pool_count_for(rate, BINLOG_BLOCK_RECORDS, BINLOG_BUFFER_S, 2)) == 0) {
+            binlog_start_writer(&binlog);
+        }
+    }
+    sweep_plan_default(&plan);
+    plan.num_steps = num_steps;
+    plan.start_cmd = start_value;
+    plan.cmd_inc = cmd_inc;
+    plan.max_cmd = max_cmd;
+    plan.adaptive = adaptive;
+    plan.fast_rcount = fast_rcount;
+    plan.hires_rcount = ldc.rcount;
+    plan.slope_thresh = slope_thresh;
+    plan.drift_every = drift_every;
+    plan.drift_model = drift_model;
+    if (sweep_init(&sweep, &plan) == -1) {
+        syslog(LOG_ERR, "Failed to allocate run summary");
+        close(log_fd);
+        return -1;
+    }
+
+    if (monitor && sysmon_start(start_time, pin_governor) == -1) {
+        monitor = 0;
+    }
+    if (hot_reload) {
+        // the run starts with the command line settings, reloads read the rig file over them
+        rig_config_init(&rig_cfg, run_entry.rig);
+        rig_cfg.rcount = ldc.rcount;
+        rig_cfg.fast_rcount = fast_rcount;
+        rig_cfg.slope_thresh = slope_thresh;
+        rig_cfg.num_samples = num_samples;
+        rig_cfg.drift_every = drift_every;
+        rig_config_path(rig_path, sizeof(rig_path), rig_cfg.rig);
+        if (hot_config_start(rig_path, &rig_cfg) == -1) {
+            hot_reload = 0;
+        }
+    }
+
+    if (detect) {
+        // by default the stop frame holds the actuator where the detector fired
+        prepare_stop(stop_cmd_set ? stop_cmd : last_cmd);
+        cusum_init(&event, CUSUM_K_DEFAULT, detect_h);
+        if (stop_cmd_set) {
+            syslog(LOG_INFO, "Event detection: CUSUM threshold %.1f sigma, stop at command %d", detect_h,
+                   stop_values[0]);
+        } else {
+            syslog(LOG_INFO, "Event detection: CUSUM threshold %.1f sigma, hold the last command", detect_h);
+        }
+    }
+
     // Get the data from the LDC1101 and log to a file
     uint8_t status_err = 0;
-    for(int step = 0; step < num_steps; step++) {
-        for(int i=0; i < num_samples; i++) {
-            status = 1;
-            while(status !=0) {
-                reg = LDC1101_LHR_STATUS; 
-                uint8_t data[2] = {reg, 0}; // Prepare data to read
-                ret = ldc1101_read_reg(reg, data, sizeof(data));
-                status = data[1] & LDC1101_LHR_DRDY; // data ready bit=0 if data is ready
+    while (sweep_running(&sweep) && !stopped) {
+        sweep_step_begin(&sweep);
+        cusum_rearm(&event); // a new command, a new level
+        if (binfile != NULL) {
+            binlog_step(&binlog, sweep.step, sweep.step_cmd);
+        }
+        for (int i = 0; i < num_samples && !stopped; ) {
+            // a new configuration takes effect between conversions
+            if (hot_reload && (live = hot_config_poll()) != NULL) {
+                apply_live_config(live, &sweep, &num_samples, log_fd, sample_index, start_time);
+                cusum_rearm(&event);
             }
-            // Read the measurement value from the LDC1101
-            uint8_t data[4] = {0, 0, 0, 0}; // Prepare data to read
-            ret = ldc1101_read_reg(LDC1101_LHR_DATA_LSB, data, sizeof(data)); // Read the data
-            if (ret == -1) {
+            // Read the next measurement values from the LDC1101; adaptive RCOUNT
+            // may switch after any sample and the detector must see every
+            // sample as it arrives, so both take them one at a time
+            int want = sweep.plan.adaptive || detect ? 1 : SAMPLE_BATCH;
+            if (want > num_samples - i) {
+                want = num_samples - i;
+            }
+            int got = ldc1101_read_samples(&ldc, batch, want, -1);
+            if (got <= 0) {
                 syslog(LOG_ERR, "Failed to read value: %s\n", strerror(errno));
-                // return -1;
-            } else {
-                clock_gettime(CLOCK_MONOTONIC, &current_time); // Get current time for timestamp
-                elapsed_time = get_elapsed_time(start_time, current_time); // Calculate elapsed time
-                value = (data[3] << 16) | (data[2] << 8) | data[1]; // Combine data bytes into value
+                i++;
+                continue;
+            }
+            for (int k = 0; k < got; k++, i++) {
+                struct timespec busy_from;
+                clock_gettime(CLOCK_MONOTONIC, &busy_from);
+                value = batch[k].code;
+                lhr_status = batch[k].status;
+                elapsed_time.tv_sec = batch[k].t_ns / 1000000000;
+                elapsed_time.tv_nsec = batch[k].t_ns % 1000000000;
+                t_sample = batch[k].t_ns * 1e-9;
+                sample_index++;
+                if (detect) {
+                    // react before anything else is done with the sample
+                    int dir = cusum_add(&event, value);
+                    if (dir != 0) {
+                        stopped = 1;
+                        int sent = send_stop();
+                        clock_gettime(CLOCK_MONOTONIC, &current_time);
+                        log_event(log_fd, &event, dir, sweep.step, value, batch[k].t_ns,
+                                  get_elapsed_time(start_time, current_time), sent);
+                    }
+                }
                 char data_line[80]; 
                 int line_length = 0; 
-                line_length =  sprintf( data_line, "%ld.%09ld, %d\n",elapsed_time.tv_sec,elapsed_time.tv_nsec, value); // format data into a string
+                if (drift_every > 0) {
+                    line_length = sprintf(data_line, "%ld.%09ld, %d, %.1f\n", elapsed_time.tv_sec, elapsed_time.tv_nsec,
+                                          value, sweep_corrected(&sweep, t_sample, value));
+                } else {
+                    line_length =  sprintf( data_line, "%ld.%09ld, %d\n",elapsed_time.tv_sec,elapsed_time.tv_nsec, value); // format data into a string
+                }
                 if (write(log_fd, data_line, line_length) == -1) {
                     syslog(LOG_ERR, "Failed to write data to log file: %s", strerror(errno));
                     fprintf(stderr, "Failed to write data to log file: %s\n", strerror(errno));
                     close(log_fd);
                     return -1; // Exit with error if data write fails
                 }
+                if (binfile != NULL &&
+                    binlog_append(&binlog, batch[k].t_ns, value, lhr_status) == -1) {
+                    close(log_fd);
+                    return -1;
+                }
+                if (monitor) {
+                    jitter_cause = sysmon_sample(t_sample);
+                    if (jitter_cause != NULL) {
+                        line_length = sprintf(data_line, "# %ld.%09ld, jitter spike cause=%s\n",
+                                              elapsed_time.tv_sec, elapsed_time.tv_nsec, jitter_cause);
+                        ret = write(log_fd, data_line, line_length);
+                    }
+                    log_sysmon_events(log_fd);
+                }
+                if (sweep_sample(&sweep, t_sample, value)) {
+                    ldc1101_set_rcount(&ldc, sweep_rcount(&sweep));
+                    log_rcount_mode(log_fd, &sweep.adapt, elapsed_time);
+                    sysmon_rate_reset(); // the conversion time changes
+                    cusum_rearm(&event); // and with it the noise
+                }
+                // the loop's own cost, without the wait for the conversion
+                clock_gettime(CLOCK_MONOTONIC, &current_time);
+                current_time = get_elapsed_time(busy_from, current_time);
+                run_summary_add_loop(&sweep.summary, batch[k].t_ns,
+                                     (int64_t)current_time.tv_sec * 1000000000 + current_time.tv_nsec);
             }
         }
-        cmd_val += cmd_inc;
-        if(abs(cmd_val) > max_cmd) {
+        ret = sweep_step_end(&sweep, &revisit);
+        if (stopped) {
+            // hold where the stop frame put the actuator, the rest of the plan is dropped
+            break;
+        }
+        if (revisit && drift_revisit(&sweep.drift, start_value, log_fd, start_time) == -1) {
+            syslog(LOG_ERR, "Drift revisit failed: %s\n", strerror(errno));
+        }
+        if (ret == -1) {
             syslog(LOG_ERR, "Command value exceeded maximum limit of %d. Stopping data collection.", max_cmd);
             break; 
         }
 
-        if (send_command(cmd_val) == -1) {
-            syslog(LOG_ERR, "Failed to send command value %d: %s\n", cmd_val, strerror(errno));
+        if (send_position(sweep.cmd_val) == -1) {
+            syslog(LOG_ERR, "Failed to send command value %d: %s\n", sweep.cmd_val, strerror(errno));
             break;
         }
+        if (detect && !stop_cmd_set) {
+            prepare_stop(last_cmd); // encoded here, between steps, not when the detector fires
+        }
+        if (sweep_command_sent(&sweep)) {
+            ldc1101_set_rcount(&ldc, sweep_rcount(&sweep));
+            clock_gettime(CLOCK_MONOTONIC, &current_time);
+            log_rcount_mode(log_fd, &sweep.adapt, get_elapsed_time(start_time, current_time));
+            sysmon_rate_reset(); // the conversion time changes
+        }
+        sysmon_sample_reset(); // the step change is not jitter
+    }
+    if (hot_reload) {
+        hot_config_stop();
+    }
+    if (monitor) {
+        log_sysmon_events(log_fd);
+        sysmon_stop(&sys_stats);
+        run_summary_set_system(&sweep.summary, &sys_stats);
+        syslog(LOG_INFO, "metric sysmon temp_max=%.1f freq_changes=%u throttle=0x%x spikes=%lu "
+               "throttled=%lu cpufreq=%lu hot=%lu unexplained=%lu", sys_stats.temp_max_c,
+               sys_stats.freq_changes, sys_stats.throttle_seen, sys_stats.spikes, sys_stats.spikes_throttled,
+               sys_stats.spikes_freq, sys_stats.spikes_hot, sys_stats.spikes_unexplained);
     }
 
     close(log_fd); 
+    if (binfile != NULL) {
+        struct batch_pool_stats pool;
+        binlog_close(&binlog);
+        batch_pool_stats(&pool);
+        syslog(LOG_INFO, "metric batch_pool capacity=%u free_min=%u refills=%lu spills=%lu exhausted=%lu stalls=%lu",
+               pool.capacity, pool.free_min, pool.refills, pool.spills, pool.exhausted, binlog.stalls);
+        batch_pool_free();
+    }
+    snprintf(summary_file, sizeof(summary_file), "%s.summary.json", logfile);
+    run_summary_write(&sweep.summary, summary_file);
+    run_summary_totals(&sweep.summary, &totals);
+    if (drift_every > 0) {
+        syslog(LOG_INFO, "metric drift revisits=%d rate=%.3f model=%s", sweep.drift.num_points - 1,
+               drift_rate(&sweep.drift), drift_model_name(sweep.drift.model));
+    }
+    ret = 0;
+
+done:
+    // register the capture in the run catalog; the one-shot modes (auto-tune,
+    // multi-rate, ILC, hysteresis fit, influence) run no sweep, so the summary
+    // fields stay zero for them
+    clock_gettime(CLOCK_MONOTONIC, &current_time);
+    elapsed_time = get_elapsed_time(start_time, current_time);
+    run_entry.start_ns = (int64_t)wall_start.tv_sec * 1000000000 + wall_start.tv_nsec;
+    run_entry.duration_s = elapsed_time.tv_sec + elapsed_time.tv_nsec * 1e-9;
+    strncpy(run_entry.log, logfile, sizeof(run_entry.log) - 1);
+    if (binfile != NULL) {
+        strncpy(run_entry.binlog, binfile, sizeof(run_entry.binlog) - 1);
+    }
+    // what the run last used: a reload may have changed them; the one-shot modes
+    // have no sweep plan and stay at the RCOUNT the sensor was opened with
+    run_entry.rcount = sweep.plan.hires_rcount != 0 ? sweep.plan.hires_rcount : ldc.rcount;
+    run_entry.fast_rcount = sweep.plan.adaptive ? sweep.plan.fast_rcount : 0;
+    run_entry.slope_thresh = sweep.plan.adaptive ? sweep.plan.slope_thresh : 0;
+    run_entry.num_samples = num_samples;
+    run_entry.num_steps = num_steps;
+    run_entry.start_cmd = start_value;
+    run_entry.cmd_inc = cmd_inc;
+    run_entry.max_cmd = max_cmd;
+    run_entry.steps_done = sweep.steps_done;
+    run_entry.samples = sweep.summary.samples;
+    run_entry.enob_mean = totals.enob_mean;
+    run_entry.enob_min = totals.enob_min;
+    run_entry.noise_rms_max = totals.noise_rms_max;
+    run_entry.snr_db_mean = totals.snr_db_mean;
+    catalog_append(catalog_file, &run_entry);
+    sweep_free(&sweep);
+    if (use_group) {
+        UDP_group_report();
+        UDP_group_close();
+    }
+    ldc1101_close(&ldc);
     syslog(LOG_INFO, "Data collection complete.\n");
     closelog();
-    return 0;
+    return ret;
 
 }
 
@@ -0,0 +1,144 @@
+/**
+ * @file mock_actuator.c
+ * @brief Local stand-in for the KASM actuator receiver. Accepts CMD_DATA
+ * frames on a UDP port and echoes every accepted datagram back to the sender,
+ * so the command path can be exercised and timed without hardware.
+ * @note A finite processing rate (-r) makes the mock drop frames the way a
+ * saturated receiver would, giving udp_stress a saturation point to find.
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "UDP_client.h"
+
+#define MOCK_DEFAULT_PORT 2345
+
+static volatile sig_atomic_t running = 1;
+
+static void on_signal(int sig){
+    (void)sig;
+    running = 0;
+}
+
+static double now_s(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]){
+    int opt = 0;
+    int port = MOCK_DEFAULT_PORT;
+    double max_rate = 0; // frames/s the mock can process, 0 = unlimited
+    int delay_us = 0; // processing delay added before each echo
+    int verbose = 0;
+
+    while ((opt = getopt(argc, argv, "hp:r:d:v")) != -1) {
+        switch(opt) {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'r':
+                max_rate = atof(optarg);
+                break;
+            case 'd':
+                delay_us = atoi(optarg);
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-p port] [-r max frames/s] [-d echo delay us] [-v]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    int sfd = socket(AF_INET6, SOCK_DGRAM, 0);
+    if (sfd == -1) {
+        fprintf(stderr, "socket: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    int v6only = 0; // accept IPv4 senders on the same socket
+    setsockopt(sfd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof v6only);
+
+    struct sockaddr_in6 addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_any;
+    addr.sin6_port = htons(port);
+    if (bind(sfd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        fprintf(stderr, "bind port %d: %s\n", port, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    struct timeval timeout = {1, 0}; // wake up to notice signals
+    setsockopt(sfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    printf("Mock actuator listening on port %d\n", port);
+
+    // token bucket: one token per frame, refilled at max_rate
+    double tokens = 1;
+    double last = now_s();
+    double burst = max_rate > 0 ? (max_rate / 100 > 1 ? max_rate / 100 : 1) : 0;
+    unsigned long received = 0, echoed = 0, dropped = 0;
+    unsigned char buf[BUF_SIZE];
+    union CMD_DATA position; // last accepted command, host byte order
+    memset(&position, 0, sizeof(position));
+
+    while (running) {
+        struct sockaddr_storage peer;
+        socklen_t peer_len = sizeof(peer);
+        ssize_t n = recvfrom(sfd, buf, sizeof(buf), 0, (struct sockaddr *)&peer, &peer_len);
+        if (n < 0) {
+            continue; // timeout or signal
+        }
+        received++;
+
+        if (max_rate > 0) {
+            double t = now_s();
+            tokens += (t - last) * max_rate;
+            last = t;
+            if (tokens > burst) {
+                tokens = burst;
+            }
+            if (tokens < 1) {
+                dropped++;
+                continue;
+            }
+            tokens -= 1;
+        }
+
+        if (n >= CMD_SIZE) {
+            for (int i = 0; i < CMD_SIZE/2; i++) {
+                int16_t v;
+                memcpy(&v, buf + 2*i, sizeof(v));
+                position.values[i] = ntohs(v);
+            }
+            if (verbose) {
+                printf("cmd[0]=%d (%zd bytes)\n", position.values[0], n);
+            }
+        }
+
+        if (delay_us > 0) {
+            usleep(delay_us);
+        }
+        if (sendto(sfd, buf, n, 0, (struct sockaddr *)&peer, peer_len) == n) {
+            echoed++;
+        }
+    }
+
+    printf("Mock actuator: %lu received, %lu echoed, %lu dropped\n", received, echoed, dropped);
+    close(sfd);
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <math.h>
+#include <string.h>
+#include <syslog.h>
+#include "mrc.h"
+
+void mrc_init(struct mrc *m, const struct pid_gains *g, double out_limit, int16_t center,
+              double gain, double tau_s, double y0, double t){
+    memset(m, 0, sizeof(*m));
+    pthread_mutex_init(&m->lock, NULL);
+    pid_init(&m->pid, g, -out_limit, out_limit);
+    m->center = center;
+    m->gain = gain;
+    m->tau = tau_s;
+    m->setpoint = y0;
+    m->t = m->win_start = t;
+    m->y = m->bias = y0;
+}
+
+void mrc_set_target(struct mrc *m, double setpoint){
+    pthread_mutex_lock(&m->lock);
+    m->setpoint = setpoint;
+    pthread_mutex_unlock(&m->lock);
+}
+
+/**
+ * @brief Integrate the model up to t with the command offset in effect
+ */
+static void predict(struct mrc *m, double t){
+    double dt = t - m->t;
+    if (dt <= 0) {
+        return;
+    }
+    double y_ss = m->bias + m->gain * m->u;
+    if (m->tau > 0) {
+        double a = exp(-dt / m->tau);
+        m->win_sum += y_ss * dt + (m->y - y_ss) * m->tau * (1 - a);
+        m->y = y_ss + (m->y - y_ss) * a;
+    } else {
+        m->win_sum += y_ss * dt;
+        m->y = y_ss;
+    }
+    m->t = t;
+}
+
+double mrc_measure(struct mrc *m, double t_end, double t_conv, uint32_t code){
+    pthread_mutex_lock(&m->lock);
+    predict(m, t_end);
+    // the code averages the window; after a gap only the end state is known
+    double window = m->t - m->win_start;
+    double mean = window > 0 && window < 1.5 * t_conv ? m->win_sum / window : m->y;
+    double e = code - mean;
+    m->bias += MRC_OBSERVER_GAIN * e;
+    m->y += MRC_OBSERVER_GAIN * e;
+    m->win_sum = 0;
+    m->win_start = m->t;
+    m->corrections++;
+    double y = m->y;
+    pthread_mutex_unlock(&m->lock);
+    return y;
+}
+
+int16_t mrc_update(struct mrc *m, double t){
+    pthread_mutex_lock(&m->lock);
+    double dt = t - m->t;
+    predict(m, t);
+    double out = pid_update(&m->pid, m->setpoint, m->y, m->period > 0 ? m->period : dt);
+    m->u = lround(out);
+    m->updates++;
+    int16_t cmd = m->center + (int16_t)m->u;
+    pthread_mutex_unlock(&m->lock);
+    return cmd;
+}
+
+static double since(struct timespec t0){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - t0.tv_sec) + (now.tv_nsec - t0.tv_nsec) * 1e-9;
+}
+
+static void *timer_loop(void *arg){
+    struct mrc *m = arg;
+    struct timespec next;
+    long period_ns = (long)(m->period * 1e9);
+    int16_t sent = m->center;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!atomic_load(&m->stop)) {
+        int16_t cmd = mrc_update(m, since(m->t0));
+        if (cmd != sent && m->send(cmd) == 0) {
+            sent = cmd;
+        }
+
+        next.tv_nsec += period_ns;
+        while (next.tv_nsec >= 1000000000) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000;
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if ((now.tv_sec - next.tv_sec) * 1000000000L + (now.tv_nsec - next.tv_nsec) > period_ns) {
+            m->late++;
+            next = now; // skip the missed ticks rather than bursting through them
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    return NULL;
+}
+
+int mrc_start(struct mrc *m, double rate_hz, struct timespec t0, int (*send)(int16_t cmd)){
+    if (rate_hz <= 0) {
+        return -1;
+    }
+    m->period = 1.0 / rate_hz;
+    m->t0 = t0;
+    m->send = send;
+    atomic_store(&m->stop, 0);
+    if (pthread_create(&m->thread, NULL, timer_loop, m) != 0) {
+        syslog(LOG_ERR, "Failed to start the control timer thread");
+        return -1;
+    }
+    return 0;
+}
+
+void mrc_stop(struct mrc *m){
+    atomic_store(&m->stop, 1);
+    pthread_join(m->thread, NULL);
+}
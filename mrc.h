@@ -0,0 +1,93 @@
+/**
+ * @file mrc.h
+ * @brief Multi-rate control: the PID command update runs on its own timer,
+ * faster than the LHR conversions, on a model prediction of the code. The
+ * plant model is the rig's static gain (codes per command unit) behind a
+ * first-order actuator lag plus an estimated offset. Between conversions it
+ * is integrated with the commands actually sent; each conversion corrects
+ * the prediction and the offset by the innovation between the code and the
+ * predicted mean over the conversion window, since the LHR code is a
+ * frequency count over that window rather than a point sample.
+ * @note The sampling thread calls mrc_measure(), the timer thread sends the
+ * commands; both take the controller's lock for a few arithmetic steps.
+ */
+
+#ifndef INC_MRC_H_
+#define INC_MRC_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#include "pid.h"
+
+#define MRC_OBSERVER_GAIN 0.5   // share of each innovation taken into the estimate
+
+struct mrc {
+    pthread_mutex_t lock;
+    struct pid pid;
+    int16_t center;         // command the output is an offset from
+    double gain;            // codes per command unit
+    double tau;             // actuator time constant, s
+    double setpoint;        // codes
+    // estimator
+    double t;               // time of y, s
+    double y;               // predicted code
+    double bias;            // code at the center command
+    double u;               // command offset in effect
+    double win_sum;         // integral of y since the last conversion
+    double win_start;
+    // timer thread
+    pthread_t thread;
+    atomic_int stop;
+    double period;          // s
+    struct timespec t0;     // time base shared with the caller
+    int (*send)(int16_t cmd);
+    unsigned long updates;      // command updates run
+    unsigned long corrections;  // conversions taken in
+    unsigned long late;         // timer ticks that missed their slot
+};
+
+/**
+ * @brief Set up the controller and estimator
+ * @param g PID gains
+ * @param out_limit largest command offset from center
+ * @param center command the rig rests at
+ * @param gain plant gain, codes per command unit
+ * @param tau_s actuator time constant
+ * @param y0 code measured at the center command
+ * @param t current time on the caller's time base, s
+ */
+void mrc_init(struct mrc *m, const struct pid_gains *g, double out_limit, int16_t center,
+              double gain, double tau_s, double y0, double t);
+
+void mrc_set_target(struct mrc *m, double setpoint);
+
+/**
+ * @brief Correct the estimate with a conversion
+ * @param t_end time the conversion result was read, s
+ * @param t_conv conversion time, s
+ * @param code LHR data code
+ * @return the corrected estimate, read under the lock
+ */
+double mrc_measure(struct mrc *m, double t_end, double t_conv, uint32_t code);
+
+/**
+ * @brief One command update on the prediction at t
+ * @return command to send
+ */
+int16_t mrc_update(struct mrc *m, double t);
+
+/**
+ * @brief Run mrc_update() at a fixed rate on a thread of its own, sending
+ * every changed command
+ * @param rate_hz command update rate
+ * @param t0 CLOCK_MONOTONIC origin of the caller's time base
+ * @param send command output
+ * @return 0 on success, -1 on failure
+ */
+int mrc_start(struct mrc *m, double rate_hz, struct timespec t0, int (*send)(int16_t cmd));
+
+void mrc_stop(struct mrc *m);
+
+#endif /* INC_MRC_H_ */
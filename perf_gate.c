@@ -0,0 +1,420 @@
+/**
+ * @file perf_gate.c
+ * @brief Statistical performance regression gate. Runs a benchmark scenario
+ * several times, stores its metrics as a JSON baseline, and compares new runs
+ * against the baseline with median/MAD and bootstrap confidence intervals.
+ * @note The benchmark writes a JSON result to the path substituted for {out}
+ * in its arguments (udp_stress -o {out}), every occurrence of it. An optional server command, such as
+ * mock_actuator, is started before the runs and stopped after them.
+ *
+ *   perf_gate record  -b base.json [-n runs] [-S server] [-m metric:higher|lower]... -- cmd ...
+ *   perf_gate compare -b base.json [-n runs] [-S server] [-t threshold %] [-m ...]... -- cmd ...
+ *
+ * compare exits with status 1 when any metric regresses.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAX_METRICS 16
+#define MAX_RUNS 100
+#define MIN_SAMPLES 3 // fewest samples per metric a median and bootstrap are taken over
+#define MAX_ARGS 64
+#define BOOTSTRAP_ITERS 2000
+
+struct metric {
+    char name[48];
+    int higher_better;
+    int n;
+    double samples[MAX_RUNS];
+};
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15u;
+
+static uint32_t rng_next(void){
+    // xorshift64*: fixed seed so a comparison is reproducible
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 0x2545F4914F6CDD1Du) >> 32);
+}
+
+static int cmp_double(const void *a, const void *b){
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(const double *v, int n){
+    double tmp[MAX_RUNS];
+    if (n <= 0) {
+        return NAN;
+    }
+    memcpy(tmp, v, n * sizeof(*v));
+    qsort(tmp, n, sizeof(*tmp), cmp_double);
+    return n % 2 ? tmp[n / 2] : 0.5 * (tmp[n / 2 - 1] + tmp[n / 2]);
+}
+
+/**
+ * @brief Median absolute deviation, scaled to estimate sigma for normal data
+ */
+static double mad(const double *v, int n){
+    double dev[MAX_RUNS];
+    double m = median(v, n);
+    for (int i = 0; i < n; i++) {
+        dev[i] = fabs(v[i] - m);
+    }
+    return 1.4826 * median(dev, n);
+}
+
+/**
+ * @brief Bootstrap 95% CI of the relative change of the median, new vs base
+ */
+static void bootstrap_ci(const struct metric *base, const struct metric *cur,
+                         double *lo, double *hi){
+    static double change[BOOTSTRAP_ITERS];
+    double rb[MAX_RUNS], rc[MAX_RUNS];
+    for (int it = 0; it < BOOTSTRAP_ITERS; it++) {
+        for (int i = 0; i < base->n; i++) {
+            rb[i] = base->samples[rng_next() % base->n];
+        }
+        for (int i = 0; i < cur->n; i++) {
+            rc[i] = cur->samples[rng_next() % cur->n];
+        }
+        double mb = median(rb, base->n);
+        change[it] = mb != 0 ? (median(rc, cur->n) - mb) / fabs(mb) : 0;
+    }
+    qsort(change, BOOTSTRAP_ITERS, sizeof(*change), cmp_double);
+    *lo = change[(int)(0.025 * BOOTSTRAP_ITERS)];
+    *hi = change[(int)(0.975 * BOOTSTRAP_ITERS) - 1];
+}
+
+/**
+ * @brief Find "key": <number> in a JSON text (first occurrence)
+ */
+static int json_number(const char *text, const char *key, double *out){
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(text, pattern);
+    if (p == NULL) {
+        return -1;
+    }
+    char *end = NULL;
+    *out = strtod(p + strlen(pattern), &end);
+    return end == p + strlen(pattern) ? -1 : 0;
+}
+
+static char *read_file(const char *path){
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    rewind(f);
+    char *text = malloc(len + 1);
+    if (text != NULL) {
+        text[fread(text, 1, len, f)] = '\0';
+    }
+    fclose(f);
+    return text;
+}
+
+static pid_t start_server(const char *cmd){
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        setpgid(0, 0);
+        execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+        _exit(127);
+    }
+    usleep(300000); // let it bind
+    return pid;
+}
+
+static void stop_server(pid_t pid){
+    if (pid > 0) {
+        kill(-pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+}
+
+/**
+ * @brief Run the benchmark once and collect the metrics from its result
+ * @return 0 on success, -1 on failure
+ */
+static int run_once(char **cmd, int cmd_len, const char *out, struct metric *metrics, int num_metrics){
+    char *args[MAX_ARGS + 1];
+    char subst[MAX_ARGS][512];
+
+    for (int i = 0; i < cmd_len; i++) {
+        // every {out} in the argument, a "sh -c" script may name it several times
+        const char *from = cmd[i];
+        const char *at;
+        size_t len = 0;
+        while ((at = strstr(from, "{out}")) != NULL && len < sizeof(subst[i])) {
+            len += snprintf(subst[i] + len, sizeof(subst[i]) - len, "%.*s%s", (int)(at - from), from, out);
+            from = at + 5;
+        }
+        if (from == cmd[i]) {
+            args[i] = cmd[i];
+            continue;
+        }
+        if (len < sizeof(subst[i])) {
+            len += snprintf(subst[i] + len, sizeof(subst[i]) - len, "%s", from);
+        }
+        if (len >= sizeof(subst[i])) {
+            fprintf(stderr, "benchmark argument too long: %s\n", cmd[i]);
+            return -1;
+        }
+        args[i] = subst[i];
+    }
+    args[cmd_len] = NULL;
+
+    unlink(out);
+    fflush(stdout); // or the child repeats our buffered output
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout);
+        execvp(args[0], args);
+        fprintf(stderr, "exec %s: %s\n", args[0], strerror(errno));
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "benchmark failed (status %d)\n", status);
+        return -1;
+    }
+
+    char *text = read_file(out);
+    if (text == NULL) {
+        fprintf(stderr, "benchmark wrote no result to %s\n", out);
+        return -1;
+    }
+    for (int m = 0; m < num_metrics; m++) {
+        double v;
+        if (json_number(text, metrics[m].name, &v) == -1) {
+            fprintf(stderr, "metric %s missing from result\n", metrics[m].name);
+            free(text);
+            return -1;
+        }
+        metrics[m].samples[metrics[m].n++] = v;
+    }
+    free(text);
+    return 0;
+}
+
+static int write_baseline(const char *path, struct metric *metrics, int num_metrics){
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fprintf(f, "{\n  \"metrics\": {\n");
+    for (int m = 0; m < num_metrics; m++) {
+        fprintf(f, "    \"%s\": {\"better\": \"%s\", \"samples\": [", metrics[m].name,
+                metrics[m].higher_better ? "higher" : "lower");
+        for (int i = 0; i < metrics[m].n; i++) {
+            fprintf(f, "%s%.6g", i ? ", " : "", metrics[m].samples[i]);
+        }
+        fprintf(f, "]}%s\n", m + 1 < num_metrics ? "," : "");
+    }
+    fprintf(f, "  }\n}\n");
+    return fclose(f);
+}
+
+static int read_baseline(const char *path, struct metric *base, const struct metric *metrics, int num_metrics){
+    char *text = read_file(path);
+    if (text == NULL) {
+        fprintf(stderr, "Failed to read baseline %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    for (int m = 0; m < num_metrics; m++) {
+        char pattern[64];
+        base[m] = metrics[m];
+        base[m].n = 0;
+        snprintf(pattern, sizeof(pattern), "\"%s\":", metrics[m].name);
+        char *p = strstr(text, pattern);
+        p = p ? strstr(p, "\"samples\": [") : NULL;
+        if (p == NULL) {
+            fprintf(stderr, "metric %s missing from baseline\n", metrics[m].name);
+            free(text);
+            return -1;
+        }
+        p += strlen("\"samples\": [");
+        while (*p != ']' && base[m].n < MAX_RUNS) {
+            char *end;
+            double v = strtod(p, &end);
+            if (end == p) {
+                break;
+            }
+            base[m].samples[base[m].n++] = v;
+            p = end;
+            while (*p == ',' || *p == ' ') {
+                p++;
+            }
+        }
+        if (base[m].n < MIN_SAMPLES) {
+            fprintf(stderr, "metric %s has %d samples in baseline %s, need at least %d\n",
+                    metrics[m].name, base[m].n, path, MIN_SAMPLES);
+            free(text);
+            return -1;
+        }
+    }
+    free(text);
+    return 0;
+}
+
+static int add_metric(struct metric *metrics, int *num_metrics, const char *spec){
+    const char *colon = strchr(spec, ':');
+    if (*num_metrics >= MAX_METRICS || colon == NULL ||
+        (strcmp(colon + 1, "higher") && strcmp(colon + 1, "lower"))) {
+        fprintf(stderr, "Bad metric '%s', expected name:higher|lower\n", spec);
+        return -1;
+    }
+    struct metric *m = &metrics[(*num_metrics)++];
+    memset(m, 0, sizeof(*m));
+    snprintf(m->name, sizeof(m->name), "%.*s", (int)(colon - spec), spec);
+    m->higher_better = strcmp(colon + 1, "higher") == 0;
+    return 0;
+}
+
+int main(int argc, char *argv[]){
+    int opt = 0;
+    char *baseline = NULL;
+    char *server = NULL;
+    int runs = 5;
+    double threshold = 5.0; // percent
+    struct metric metrics[MAX_METRICS];
+    int num_metrics = 0;
+    char out[] = "/tmp/perf_gate_XXXXXX";
+
+    if (argc < 2 || (strcmp(argv[1], "record") && strcmp(argv[1], "compare"))) {
+        fprintf(stderr, "Usage: %s record|compare -b baseline.json [-n runs] [-S server cmd] "
+                "[-t threshold %%] [-m metric:higher|lower]... -- benchmark args ({out} = result path)\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    int record = strcmp(argv[1], "record") == 0;
+    optind = 2;
+
+    while ((opt = getopt(argc, argv, "hb:n:S:t:m:")) != -1) {
+        switch(opt) {
+            case 'b':
+                baseline = optarg;
+                break;
+            case 'n':
+                runs = atoi(optarg);
+                break;
+            case 'S':
+                server = optarg;
+                break;
+            case 't':
+                threshold = atof(optarg);
+                break;
+            case 'm':
+                if (add_metric(metrics, &num_metrics, optarg) == -1) {
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s record|compare -b baseline.json [-n runs] [-S server cmd] "
+                        "[-t threshold %%] [-m metric:higher|lower]... -- benchmark args\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (baseline == NULL || optind >= argc || argc - optind > MAX_ARGS || runs < MIN_SAMPLES || runs > MAX_RUNS) {
+        fprintf(stderr, "Need -b, a benchmark command and %d..%d runs\n", MIN_SAMPLES, MAX_RUNS);
+        exit(EXIT_FAILURE);
+    }
+    if (num_metrics == 0) { // udp_stress headline figures
+        add_metric(metrics, &num_metrics, "max_ok_rate:higher");
+        add_metric(metrics, &num_metrics, "p99_latency_us:lower");
+        add_metric(metrics, &num_metrics, "p999_latency_us:lower");
+    }
+
+    int tmp = mkstemp(out);
+    if (tmp == -1) {
+        fprintf(stderr, "mkstemp: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    close(tmp);
+
+    pid_t server_pid = server != NULL ? start_server(server) : -1;
+    for (int r = 0; r < runs; r++) {
+        if (run_once(&argv[optind], argc - optind, out, metrics, num_metrics) == -1) {
+            stop_server(server_pid);
+            unlink(out);
+            exit(EXIT_FAILURE);
+        }
+        printf("run %d/%d done\n", r + 1, runs);
+    }
+    stop_server(server_pid);
+    unlink(out);
+    for (int m = 0; m < num_metrics; m++) {
+        if (metrics[m].n < MIN_SAMPLES) {
+            fprintf(stderr, "metric %s has %d samples from this run, need at least %d\n",
+                    metrics[m].name, metrics[m].n, MIN_SAMPLES);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (record) {
+        if (write_baseline(baseline, metrics, num_metrics) != 0) {
+            exit(EXIT_FAILURE);
+        }
+        for (int m = 0; m < num_metrics; m++) {
+            printf("%-20s median %12.3f  MAD %10.3f\n", metrics[m].name,
+                   median(metrics[m].samples, metrics[m].n), mad(metrics[m].samples, metrics[m].n));
+        }
+        printf("Baseline written to %s\n", baseline);
+        return 0;
+    }
+
+    struct metric base[MAX_METRICS];
+    if (read_baseline(baseline, base, metrics, num_metrics) == -1) {
+        exit(EXIT_FAILURE);
+    }
+
+    int regressions = 0;
+    printf("%-20s %12s %12s %10s %10s %19s  %s\n", "metric", "base med", "new med",
+           "new MAD", "change", "95% CI", "verdict");
+    for (int m = 0; m < num_metrics; m++) {
+        double mb = median(base[m].samples, base[m].n);
+        double mc = median(metrics[m].samples, metrics[m].n);
+        double change = mb != 0 ? (mc - mb) / fabs(mb) : 0;
+        double lo, hi;
+        bootstrap_ci(&base[m], &metrics[m], &lo, &hi);
+
+        // worse = the direction that hurts; need the CI clear of zero and the
+        // median change past the threshold before calling it a regression
+        double worse = metrics[m].higher_better ? -change : change;
+        int ci_worse = metrics[m].higher_better ? hi < 0 : lo > 0;
+        int ci_better = metrics[m].higher_better ? lo > 0 : hi < 0;
+        const char *verdict = "no change";
+        if (ci_worse && worse * 100 > threshold) {
+            verdict = "REGRESSION";
+            regressions++;
+        } else if (ci_worse) {
+            verdict = "worse (within threshold)";
+        } else if (ci_better) {
+            verdict = "improved";
+        }
+        printf("%-20s %12.3f %12.3f %10.3f %+9.2f%% [%+7.2f%%,%+7.2f%%]  %s\n", metrics[m].name,
+               mb, mc, mad(metrics[m].samples, metrics[m].n), 100 * change, 100 * lo, 100 * hi, verdict);
+    }
+
+    if (regressions > 0) {
+        printf("%d metric(s) regressed beyond %.1f%%\n", regressions, threshold);
+        return 1;
+    }
+    printf("No regressions beyond %.1f%%\n", threshold);
+    return 0;
+}
@@ -0,0 +1,30 @@
+#include <string.h>
+#include "pid.h"
+
+void pid_init(struct pid *p, const struct pid_gains *g, double out_min, double out_max){
+    memset(p, 0, sizeof(*p));
+    p->g = *g;
+    p->out_min = out_min;
+    p->out_max = out_max;
+}
+
+double pid_update(struct pid *p, double setpoint, double y, double dt){
+    double err = setpoint - y;
+    double deriv = 0;
+    if (p->have_prev && dt > 0) {
+        deriv = -(y - p->prev_y) / dt;
+    }
+    p->prev_y = y;
+    p->have_prev = 1;
+
+    double integ = p->integ + p->g.ki * err * dt;
+    double out = p->g.kp * err + integ + p->g.kd * deriv;
+    if (out > p->out_max) {
+        out = p->out_max;
+    } else if (out < p->out_min) {
+        out = p->out_min;
+    } else {
+        p->integ = integ; // only integrate while the output is free to move
+    }
+    return out;
+}
@@ -0,0 +1,37 @@
+/**
+ * @file pid.h
+ * @brief Discrete PID controller acting on LHR codes, with derivative on the
+ * measurement (no kick on setpoint changes) and conditional integration
+ * while the output is saturated.
+ */
+
+#ifndef INC_PID_H_
+#define INC_PID_H_
+
+struct pid_gains {
+    double kp;   // command units per code, negative for reverse-acting rigs
+    double ki;   // per second
+    double kd;   // seconds
+};
+
+struct pid {
+    struct pid_gains g;
+    double out_min;
+    double out_max;
+    double integ;
+    double prev_y;
+    int have_prev;
+};
+
+void pid_init(struct pid *p, const struct pid_gains *g, double out_min, double out_max);
+
+/**
+ * @brief One controller update
+ * @param setpoint target code
+ * @param y measured code
+ * @param dt seconds since the previous update
+ * @return controller output, clamped to [out_min, out_max]
+ */
+double pid_update(struct pid *p, double setpoint, double y, double dt);
+
+#endif /* INC_PID_H_ */
@@ -0,0 +1,70 @@
+#include <math.h>
+#include <string.h>
+#include "rcount_adapt.h"
+
+#define SLOPE_ALPHA 0.3 // smoothing of the sample-to-sample slope
+
+void rcount_adapt_init(struct rcount_adapt *ra, uint16_t fast_rcount,
+                       uint16_t hires_rcount, double slope_thresh){
+    memset(ra, 0, sizeof(*ra));
+    ra->fast_rcount = fast_rcount;
+    ra->hires_rcount = hires_rcount;
+    ra->slope_thresh = slope_thresh;
+    ra->hold_samples = RCOUNT_HOLD_SAMPLES;
+    ra->settle_samples = RCOUNT_SETTLE_SAMPLES;
+    ra->mode = RCOUNT_HIRES;
+}
+
+static int set_mode(struct rcount_adapt *ra, enum rcount_mode mode){
+    if (ra->mode == mode) {
+        return 0;
+    }
+    ra->mode = mode;
+    ra->quiet = 0;
+    // the reconfiguration gap and the new noise level would fake a slope
+    ra->have_prev = 0;
+    ra->slope = 0;
+    return 1;
+}
+
+int rcount_adapt_command(struct rcount_adapt *ra){
+    ra->hold_left = ra->hold_samples;
+    return set_mode(ra, RCOUNT_FAST);
+}
+
+int rcount_adapt_sample(struct rcount_adapt *ra, double t, uint32_t code){
+    if (ra->have_prev && t > ra->prev_t) {
+        double inst = fabs(((double)code - (double)ra->prev_code) / (t - ra->prev_t));
+        ra->slope = SLOPE_ALPHA * inst + (1 - SLOPE_ALPHA) * ra->slope;
+    }
+    ra->prev_t = t;
+    ra->prev_code = code;
+    int had_prev = ra->have_prev;
+    ra->have_prev = 1;
+    if (!had_prev) {
+        return 0; // need two samples for a slope
+    }
+
+    if (ra->hold_left > 0) {
+        ra->hold_left--;
+    }
+
+    if (ra->slope > ra->slope_thresh) {
+        ra->quiet = 0;
+        return set_mode(ra, RCOUNT_FAST);
+    }
+
+    ra->quiet++;
+    if (ra->mode == RCOUNT_FAST && ra->hold_left == 0 && ra->quiet >= ra->settle_samples) {
+        return set_mode(ra, RCOUNT_HIRES);
+    }
+    return 0;
+}
+
+uint16_t rcount_adapt_rcount(const struct rcount_adapt *ra){
+    return ra->mode == RCOUNT_FAST ? ra->fast_rcount : ra->hires_rcount;
+}
+
+const char *rcount_mode_name(enum rcount_mode mode){
+    return mode == RCOUNT_FAST ? "fast" : "hires";
+}
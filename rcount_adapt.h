@@ -0,0 +1,74 @@
+/**
+ * @file rcount_adapt.h
+ * @brief Adaptive LHR RCOUNT selection: a short RCOUNT (fast conversions)
+ * while the actuator is moving, a long RCOUNT (high resolution) once the
+ * signal has settled.
+ * @note Slopes are in raw LHR_DATA codes per second. The code is
+ * f_sensor/f_CLKIN * 2^24 whatever the RCOUNT, so no normalisation is
+ * applied and the threshold means the same in both modes; a short RCOUNT
+ * only coarsens the code, to steps of 2^24/(16 RCOUNT).
+ */
+
+#ifndef INC_RCOUNT_ADAPT_H_
+#define INC_RCOUNT_ADAPT_H_
+
+#include <stdint.h>
+
+#define RCOUNT_HIRES_DEFAULT 0xffff
+#define RCOUNT_FAST_DEFAULT 0x0400
+#define RCOUNT_SLOPE_DEFAULT 1000.0 // codes/s above which the signal is moving
+#define RCOUNT_HOLD_SAMPLES 20      // fast samples taken after every command
+#define RCOUNT_SETTLE_SAMPLES 20    // quiet samples needed to go back to hires
+
+enum rcount_mode {
+    RCOUNT_HIRES = 0,
+    RCOUNT_FAST = 1
+};
+
+struct rcount_adapt {
+    uint16_t fast_rcount;
+    uint16_t hires_rcount;
+    double slope_thresh;  // codes/s
+    int hold_samples;
+    int settle_samples;
+    enum rcount_mode mode;
+    int hold_left;        // fast samples still owed to the last command
+    int quiet;            // consecutive samples below slope_thresh
+    double slope;         // smoothed |dcode/dt|
+    double prev_t;
+    uint32_t prev_code;
+    int have_prev;
+};
+
+/**
+ * @brief Initialize the adaptive state in high resolution mode
+ * @param ra state
+ * @param fast_rcount RCOUNT used during transients
+ * @param hires_rcount RCOUNT used while holding
+ * @param slope_thresh |slope| in codes/s that counts as a transient
+ */
+void rcount_adapt_init(struct rcount_adapt *ra, uint16_t fast_rcount,
+                       uint16_t hires_rcount, double slope_thresh);
+
+/**
+ * @brief Notify that a command was just sent to the actuator
+ * @return 1 if the mode changed, 0 otherwise
+ */
+int rcount_adapt_command(struct rcount_adapt *ra);
+
+/**
+ * @brief Feed one conversion result
+ * @param t sample time in seconds
+ * @param code LHR data code
+ * @return 1 if the mode changed, 0 otherwise
+ */
+int rcount_adapt_sample(struct rcount_adapt *ra, double t, uint32_t code);
+
+/**
+ * @brief RCOUNT for the current mode
+ */
+uint16_t rcount_adapt_rcount(const struct rcount_adapt *ra);
+
+const char *rcount_mode_name(enum rcount_mode mode);
+
+#endif /* INC_RCOUNT_ADAPT_H_ */
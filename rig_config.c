@@ -0,0 +1,240 @@
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "rcount_adapt.h"
+#include "rig_config.h"
+
+enum field_type { F_TEXT, F_DOUBLE, F_INT, F_I64 };
+
+struct field {
+    const char *name;
+    enum field_type type;
+    size_t offset;
+    size_t len; // text fields
+};
+
+#define FIELD(n, t) {#n, t, offsetof(struct rig_config, n), sizeof(((struct rig_config *)0)->n)}
+#define SIM_FIELD(n, t) {"sim_" #n, t, offsetof(struct rig_config, sim.n), sizeof(((struct rig_config *)0)->sim.n)}
+
+static const struct field fields[] = {
+    FIELD(rig, F_TEXT),
+    FIELD(rcount, F_INT),
+    FIELD(fast_rcount, F_INT),
+    FIELD(slope_thresh, F_DOUBLE),
+    FIELD(num_samples, F_INT),
+    FIELD(drift_every, F_INT),
+    FIELD(kp, F_DOUBLE),
+    FIELD(ki, F_DOUBLE),
+    FIELD(kd, F_DOUBLE),
+    FIELD(plant_tau_ms, F_DOUBLE),
+    FIELD(rule, F_TEXT),
+    FIELD(ku, F_DOUBLE),
+    FIELD(tu, F_DOUBLE),
+    FIELD(center_cmd, F_INT),
+    FIELD(relay_amp, F_INT),
+    FIELD(plant_gain, F_DOUBLE),
+    FIELD(tuned, F_I64),
+    SIM_FIELD(clkin_mhz, F_DOUBLE),
+    SIM_FIELD(l0_uh, F_DOUBLE),
+    SIM_FIELD(c_pf, F_DOUBLE),
+    SIM_FIELD(coil_radius_mm, F_DOUBLE),
+    SIM_FIELD(coupling, F_DOUBLE),
+    SIM_FIELD(standoff_mm, F_DOUBLE),
+    SIM_FIELD(um_per_cmd, F_DOUBLE),
+    SIM_FIELD(act_tau_ms, F_DOUBLE),
+    SIM_FIELD(backlash_um, F_DOUBLE),
+    SIM_FIELD(channel, F_INT),
+    SIM_FIELD(channel_spread, F_DOUBLE),
+    SIM_FIELD(rp_far_kohm, F_DOUBLE),
+    SIM_FIELD(rp_min_kohm, F_DOUBLE),
+    SIM_FIELD(white_ppm, F_DOUBLE),
+    SIM_FIELD(flicker_ppm, F_DOUBLE),
+    SIM_FIELD(temp_c, F_DOUBLE),
+    SIM_FIELD(warmup_c, F_DOUBLE),
+    SIM_FIELD(warmup_s, F_DOUBLE),
+    SIM_FIELD(tc_l_ppm, F_DOUBLE),
+    SIM_FIELD(tc_c_ppm, F_DOUBLE),
+    SIM_FIELD(seed, F_INT),
+};
+#define NUM_FIELDS (int)(sizeof(fields) / sizeof(fields[0]))
+
+void rig_config_init(struct rig_config *cfg, const char *rig){
+    memset(cfg, 0, sizeof(*cfg));
+    strncpy(cfg->rig, rig != NULL && rig[0] != '\0' ? rig : RIG_DEFAULT, sizeof(cfg->rig) - 1);
+    cfg->rcount = RCOUNT_HIRES_DEFAULT;
+    cfg->fast_rcount = RCOUNT_FAST_DEFAULT;
+    cfg->slope_thresh = RCOUNT_SLOPE_DEFAULT;
+    cfg->num_samples = 500;
+    cfg->plant_tau_ms = 5.0;
+    ldc_sim_model_default(&cfg->sim);
+}
+
+int rig_config_validate(const struct rig_config *cfg, char *why, size_t len){
+    if (cfg->rcount < 1 || cfg->rcount > 0xFFFF) {
+        snprintf(why, len, "rcount 0x%X out of range", cfg->rcount);
+    } else if (cfg->fast_rcount < 1 || cfg->fast_rcount >= cfg->rcount) {
+        snprintf(why, len, "fast_rcount must be below rcount");
+    } else if (cfg->slope_thresh <= 0) {
+        snprintf(why, len, "slope_thresh must be positive");
+    } else if (cfg->num_samples <= 0 || cfg->num_samples > 1000) {
+        snprintf(why, len, "num_samples must be 1..1000");
+    } else if (cfg->drift_every < 0) {
+        snprintf(why, len, "drift_every must not be negative");
+    } else {
+        return 0;
+    }
+    return -1;
+}
+
+int rig_config_path(char *buf, size_t len, const char *rig){
+    int n = snprintf(buf, len, "%s/%s.conf", RIG_CONFIG_DIR, rig != NULL && rig[0] != '\0' ? rig : RIG_DEFAULT);
+    return n < 0 || (size_t)n >= len ? -1 : 0;
+}
+
+static char *trim(char *s){
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) {
+        *--end = '\0';
+    }
+    return s;
+}
+
+/**
+ * @brief Parse a value into its field, the field is only written when the whole value parses
+ * @return 0 on success, -1 on a malformed or out of range value
+ */
+static int set_field(struct rig_config *cfg, const struct field *f, const char *value){
+    char *p = (char *)cfg + f->offset;
+    char *end = NULL;
+    double d;
+    long l;
+    long long ll;
+
+    errno = 0;
+    switch (f->type) {
+        case F_TEXT:
+            memset(p, 0, f->len);
+            strncpy(p, value, f->len - 1);
+            return 0;
+        case F_DOUBLE:
+            d = strtod(value, &end);
+            if (end == value || *end != '\0' || errno == ERANGE) {
+                return -1;
+            }
+            *(double *)p = d;
+            return 0;
+        case F_INT:
+            l = strtol(value, &end, 0);
+            if (end == value || *end != '\0' || errno == ERANGE || l < INT_MIN || l > INT_MAX) {
+                return -1;
+            }
+            *(int *)p = (int)l;
+            return 0;
+        case F_I64:
+            ll = strtoll(value, &end, 0);
+            if (end == value || *end != '\0' || errno == ERANGE) {
+                return -1;
+            }
+            *(int64_t *)p = ll;
+            return 0;
+    }
+    return -1;
+}
+
+/**
+ * @param strict 1 to fail when any line is bad, 0 to report bad lines and skip them
+ */
+static int load(const char *path, struct rig_config *cfg, int strict){
+    char line[160];
+    int line_num = 0;
+    int bad = 0;
+    int level = strict ? LOG_ERR : LOG_WARNING;
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_num++;
+        char *key = trim(line);
+        if (key[0] == '\0' || key[0] == '#') {
+            continue;
+        }
+        char *eq = strchr(key, '=');
+        if (eq == NULL) {
+            syslog(level, "%s:%d: expected key = value", path, line_num);
+            bad = 1;
+            continue;
+        }
+        *eq = '\0';
+        key = trim(key);
+        char *value = trim(eq + 1);
+        int i = 0;
+        while (i < NUM_FIELDS && strcmp(fields[i].name, key) != 0) {
+            i++;
+        }
+        if (i == NUM_FIELDS) {
+            syslog(level, "%s:%d: unknown key %s", path, line_num, key);
+            bad = 1;
+        } else if (set_field(cfg, &fields[i], value) == -1) {
+            syslog(level, "%s:%d: bad value for %s: %s", path, line_num, key, value);
+            bad = 1;
+        }
+    }
+    fclose(f);
+    if (strict && bad) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+int rig_config_load(const char *path, struct rig_config *cfg){
+    return load(path, cfg, 0);
+}
+
+int rig_config_load_strict(const char *path, struct rig_config *cfg){
+    struct rig_config tmp = *cfg;
+    if (load(path, &tmp, 1) == -1) {
+        return -1;
+    }
+    *cfg = tmp;
+    return 0;
+}
+
+int rig_config_save(const char *path, const struct rig_config *cfg){
+    char tmp[288];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    mkdir(RIG_CONFIG_DIR, 0777); // first rig on this host
+    FILE *f = fopen(tmp, "w");
+    if (f == NULL) {
+        syslog(LOG_ERR, "Failed to write rig configuration %s: %s", tmp, strerror(errno));
+        return -1;
+    }
+    fprintf(f, "# LDC1101 rig configuration\n");
+    for (int i = 0; i < NUM_FIELDS; i++) {
+        const char *p = (const char *)cfg + fields[i].offset;
+        fprintf(f, "%s = ", fields[i].name);
+        switch (fields[i].type) {
+            case F_TEXT:   fprintf(f, "%s\n", p); break;
+            case F_DOUBLE: fprintf(f, "%.9g\n", *(const double *)p); break;
+            case F_INT:    fprintf(f, "%d\n", *(const int *)p); break;
+            case F_I64:    fprintf(f, "%lld\n", (long long)*(const int64_t *)p); break;
+        }
+    }
+    // rename() replaces the old file whole, readers never see a partial one
+    if (fclose(f) != 0 || rename(tmp, path) == -1) {
+        syslog(LOG_ERR, "Failed to save rig configuration %s: %s", path, strerror(errno));
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
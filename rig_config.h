@@ -0,0 +1,83 @@
+/**
+ * @file rig_config.h
+ * @brief Per-rig configuration kept in a "key = value" text file, one file
+ * per rig id (main's -R). Holds the controller gains found by auto-tuning
+ * and, for simulated rigs, the sensor model (sim_* keys).
+ */
+
+#ifndef INC_RIG_CONFIG_H_
+#define INC_RIG_CONFIG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ldc_sim.h"
+
+#define RIG_CONFIG_DIR "./testing/rigs"
+#define RIG_DEFAULT "default"
+
+struct rig_config {
+    char rig[24];
+    // acquisition, changeable mid-run with main -W
+    int rcount;           // LHR RCOUNT in high resolution mode
+    int fast_rcount;      // adaptive RCOUNT during transients
+    double slope_thresh;  // codes/s that count as a transient
+    int num_samples;      // per step
+    int drift_every;      // drift revisit interval in steps
+    // controller
+    double kp;            // command units per code
+    double ki;            // per second
+    double kd;            // seconds
+    double plant_tau_ms;  // actuator time constant, multi-rate estimator (main -K)
+    // auto-tune result the gains came from
+    char rule[16];
+    double ku;            // ultimate gain, command units per code
+    double tu;            // ultimate period, s
+    int center_cmd;
+    int relay_amp;
+    double plant_gain;    // codes per command unit, from the probe step
+    int64_t tuned;        // seconds since the epoch, 0 if never tuned
+    // simulated sensor (main -S)
+    struct ldc_sim_model sim;
+};
+
+/**
+ * @brief main()'s acquisition defaults, zero gains and the default sensor
+ * model for the given rig id (RIG_DEFAULT if empty)
+ */
+void rig_config_init(struct rig_config *cfg, const char *rig);
+
+/**
+ * @brief Path of the rig's configuration file
+ * @return 0 on success, -1 if it does not fit in len
+ */
+int rig_config_path(char *buf, size_t len, const char *rig);
+
+/**
+ * @brief Read a configuration file over the current values
+ * @return 0 on success, -1 if the file cannot be read (errno set)
+ * @note Unknown keys and malformed lines are reported and skipped; a bad
+ * value leaves its field unchanged.
+ */
+int rig_config_load(const char *path, struct rig_config *cfg);
+
+/**
+ * @brief Read a configuration file over the current values, all or nothing
+ * @return 0 on success, -1 if the file cannot be read or has an unknown key,
+ * a malformed line or a bad value (errno EINVAL); cfg is then unchanged
+ */
+int rig_config_load_strict(const char *path, struct rig_config *cfg);
+
+/**
+ * @brief Check the acquisition settings
+ * @param why receives the reason when invalid
+ * @return 0 if usable, -1 otherwise
+ */
+int rig_config_validate(const struct rig_config *cfg, char *why, size_t len);
+
+/**
+ * @brief Write the configuration, replacing the file atomically
+ * @return 0 on success, -1 on failure
+ */
+int rig_config_save(const char *path, const struct rig_config *cfg);
+
+#endif /* INC_RIG_CONFIG_H_ */
@@ -0,0 +1,158 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include "run_summary.h"
+
+int run_summary_init(struct run_summary *rs, int expected_steps){
+    memset(rs, 0, sizeof(*rs));
+    rs->cap = expected_steps > 0 ? expected_steps : 16;
+    rs->steps = calloc(rs->cap, sizeof(*rs->steps));
+    rs->sketches = calloc(rs->cap, sizeof(*rs->sketches));
+    kll_init(&rs->loop_ns);
+    return (rs->steps == NULL || rs->sketches == NULL) ? -1 : 0;
+}
+
+void run_summary_add_step(struct run_summary *rs, const struct step_stats *st,
+                          const struct kll_sketch *sketch){
+    if (rs->num_steps == rs->cap) {
+        struct step_result *grown = realloc(rs->steps, 2 * rs->cap * sizeof(*rs->steps));
+        struct kll_sketch *grown_sk = grown ? realloc(rs->sketches, 2 * rs->cap * sizeof(*rs->sketches)) : NULL;
+        if (grown != NULL) {
+            rs->steps = grown;
+        }
+        if (grown_sk == NULL) {
+            syslog(LOG_ERR, "Run summary full, step %d dropped", st->step);
+            return;
+        }
+        rs->sketches = grown_sk;
+        rs->cap *= 2;
+    }
+
+    int i = rs->num_steps++;
+    struct step_result *res = &rs->steps[i];
+    step_stats_result(st, i > 0 ? &rs->prev : NULL, res);
+    rs->prev = *st;
+    rs->samples += st->n;
+    rs->prev_read_ns = rs->prev_interval_ns = 0;
+    if (sketch != NULL) {
+        rs->sketches[i] = *sketch;
+        res->p1 = kll_quantile(sketch, 0.01);
+        res->p50 = kll_quantile(sketch, 0.50);
+        res->p99 = kll_quantile(sketch, 0.99);
+    } else {
+        kll_init(&rs->sketches[i]);
+    }
+
+    syslog(LOG_INFO, "metric step=%d cmd=%d n=%lu mean=%.1f slope=%.1f rms=%.2f snr_db=%.1f enob=%.2f "
+           "p1=%u p50=%u p99=%u", res->step, res->cmd_val, res->n, res->mean, res->slope,
+           res->noise_rms, res->snr_db, res->enob, res->p1, res->p50, res->p99);
+}
+
+void run_summary_totals(const struct run_summary *rs, struct run_totals *tot){
+    double enob_sum = 0, snr_sum = 0;
+    int snr_count = 0;
+
+    memset(tot, 0, sizeof(*tot));
+    tot->enob_min = rs->num_steps ? LHR_BITS : 0;
+    for (int i = 0; i < rs->num_steps; i++) {
+        const struct step_result *r = &rs->steps[i];
+        enob_sum += r->enob;
+        if (r->enob < tot->enob_min) {
+            tot->enob_min = r->enob;
+        }
+        if (r->noise_rms > tot->noise_rms_max) {
+            tot->noise_rms_max = r->noise_rms;
+        }
+        if (r->span > 0) {
+            snr_sum += r->snr_db;
+            snr_count++;
+        }
+    }
+    tot->enob_mean = rs->num_steps ? enob_sum / rs->num_steps : 0;
+    tot->snr_db_mean = snr_count ? snr_sum / snr_count : 0;
+}
+
+void run_summary_set_system(struct run_summary *rs, const struct sysmon_stats *sys){
+    rs->system = *sys;
+    rs->have_system = 1;
+}
+
+void run_summary_add_loop(struct run_summary *rs, int64_t t_read_ns, int64_t busy_ns){
+    kll_update(&rs->loop_ns, busy_ns < 0 ? 0 : busy_ns > UINT32_MAX ? UINT32_MAX : (uint32_t)busy_ns);
+    if (rs->prev_read_ns > 0) {
+        int64_t interval = t_read_ns - rs->prev_read_ns;
+        if (rs->prev_interval_ns > 0) {
+            double d = (double)(interval - rs->prev_interval_ns);
+            rs->jitter_sum_sq += d * d;
+            rs->jitter_n++;
+        }
+        rs->prev_interval_ns = interval;
+    }
+    rs->prev_read_ns = t_read_ns;
+}
+
+int run_summary_write(const struct run_summary *rs, const char *path){
+    struct run_totals tot;
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        syslog(LOG_ERR, "Failed to open summary %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    run_summary_totals(rs, &tot);
+    fprintf(f, "{\n");
+    fprintf(f, "  \"steps_count\": %d,\n", rs->num_steps);
+    fprintf(f, "  \"samples\": %lu,\n", rs->samples);
+    fprintf(f, "  \"enob_mean\": %.3f,\n", tot.enob_mean);
+    fprintf(f, "  \"enob_min\": %.3f,\n", tot.enob_min);
+    fprintf(f, "  \"noise_rms_max\": %.3f,\n", tot.noise_rms_max);
+    fprintf(f, "  \"snr_db_mean\": %.2f,\n", tot.snr_db_mean);
+    if (rs->have_system) {
+        const struct sysmon_stats *sys = &rs->system;
+        fprintf(f, "  \"system\": {\"temp_max_c\": %.1f, \"freq_min_khz\": %u, \"freq_max_khz\": %u, "
+                "\"freq_changes\": %u, \"throttle_changes\": %u, \"throttle_seen\": \"0x%x\", "
+                "\"governor_pinned\": %d, \"spikes\": %lu, \"spikes_throttled\": %lu, \"spikes_freq\": %lu, "
+                "\"spikes_hot\": %lu, \"spikes_unexplained\": %lu, \"worst_spike_ms\": %.3f},\n",
+                sys->temp_max_c, sys->freq_min_khz, sys->freq_max_khz, sys->freq_changes,
+                sys->throttle_changes, sys->throttle_seen, sys->governor_pinned, sys->spikes,
+                sys->spikes_throttled, sys->spikes_freq, sys->spikes_hot, sys->spikes_unexplained,
+                sys->worst_spike_s * 1e3);
+    }
+    if (rs->loop_ns.n > 0) {
+        // the difference of two intervals carries the jitter of both: sqrt(2) sigma
+        double jitter = rs->jitter_n ? sqrt(rs->jitter_sum_sq / rs->jitter_n / 2) : 0;
+        fprintf(f, "  \"loop\": {\"loop_samples\": %llu, \"loop_p50_us\": %.3f, \"loop_p99_us\": %.3f, "
+                "\"loop_max_us\": %.3f, \"interval_jitter_us\": %.3f},\n", (unsigned long long)rs->loop_ns.n,
+                kll_quantile(&rs->loop_ns, 0.50) * 1e-3, kll_quantile(&rs->loop_ns, 0.99) * 1e-3,
+                rs->loop_ns.max * 1e-3, jitter * 1e-3);
+    }
+    fprintf(f, "  \"steps\": [\n");
+    for (int i = 0; i < rs->num_steps; i++) {
+        const struct step_result *r = &rs->steps[i];
+        fprintf(f, "    {\"step\": %d, \"cmd\": %d, \"n\": %lu, \"mean\": %.3f, \"slope\": %.3f, "
+                "\"noise_rms\": %.3f, \"span\": %.3f, \"snr_db\": %.2f, \"enob\": %.3f, "
+                "\"p1\": %u, \"p50\": %u, \"p99\": %u, \"sketch\": ",
+                r->step, r->cmd_val, r->n, r->mean, r->slope, r->noise_rms, r->span,
+                r->snr_db, r->enob, r->p1, r->p50, r->p99);
+        kll_write_json(f, &rs->sketches[i]);
+        fprintf(f, "}%s\n", i + 1 < rs->num_steps ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+
+    if (fclose(f) != 0) {
+        syslog(LOG_ERR, "Failed to write summary %s: %s", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void run_summary_free(struct run_summary *rs){
+    free(rs->steps);
+    free(rs->sketches);
+    rs->steps = NULL;
+    rs->sketches = NULL;
+    rs->num_steps = rs->cap = 0;
+}
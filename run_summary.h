@@ -0,0 +1,73 @@
+/**
+ * @file run_summary.h
+ * @brief Per-run summary: one result per step plus run-level figures,
+ * logged as metrics while the run progresses and written as JSON at the end.
+ */
+
+#ifndef INC_RUN_SUMMARY_H_
+#define INC_RUN_SUMMARY_H_
+
+#include "step_stats.h"
+#include "kll.h"
+#include "sysmon.h"
+
+struct run_summary {
+    struct step_result *steps;
+    struct kll_sketch *sketches; // per step, serialised with the step
+    int num_steps;
+    int cap;
+    struct step_stats prev; // last finished step, for the span
+    unsigned long samples;
+    struct sysmon_stats system; // valid when have_system is set
+    int have_system;
+    // sampling loop timing, written when any sample was timed
+    struct kll_sketch loop_ns;  // processing time per sample
+    int64_t prev_read_ns;       // 0 after a step change, which is not jitter
+    int64_t prev_interval_ns;
+    unsigned long jitter_n;
+    double jitter_sum_sq;       // successive interval differences, ns^2
+};
+
+// Run-level figures over all recorded steps
+struct run_totals {
+    double enob_mean;
+    double enob_min;
+    double noise_rms_max;
+    double snr_db_mean;     // over steps with a known span
+};
+
+int run_summary_init(struct run_summary *rs, int expected_steps);
+
+/**
+ * @brief Record a finished step and log its metrics line
+ * @param sketch quantile sketch of the step's codes, or NULL
+ */
+void run_summary_add_step(struct run_summary *rs, const struct step_stats *st,
+                          const struct kll_sketch *sketch);
+
+/**
+ * @brief Attach the system monitor figures of the run
+ */
+void run_summary_set_system(struct run_summary *rs, const struct sysmon_stats *sys);
+
+/**
+ * @brief Time one pass of the sampling loop
+ * @param t_read_ns time the sample was read
+ * @param busy_ns time spent processing it: detection, logs, statistics
+ * @note The interval jitter is taken from successive interval differences, so
+ * it follows a change of conversion time (adaptive RCOUNT) within a sample.
+ */
+void run_summary_add_loop(struct run_summary *rs, int64_t t_read_ns, int64_t busy_ns);
+
+void run_summary_totals(const struct run_summary *rs, struct run_totals *tot);
+
+/**
+ * @brief Write the summary as JSON
+ * @param path output file
+ * @return 0 on success, -1 on failure
+ */
+int run_summary_write(const struct run_summary *rs, const char *path);
+
+void run_summary_free(struct run_summary *rs);
+
+#endif /* INC_RUN_SUMMARY_H_ */
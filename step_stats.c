@@ -0,0 +1,100 @@
+#include <math.h>
+#include <string.h>
+#include "step_stats.h"
+
+void step_stats_init(struct step_stats *st, int step, int16_t cmd_val){
+    memset(st, 0, sizeof(*st));
+    st->step = step;
+    st->cmd_val = cmd_val;
+    st->min = UINT32_MAX;
+}
+
+void step_stats_add(struct step_stats *st, double t, uint32_t code){
+    // Welford update of the means and (co-)moments
+    double y = code;
+    st->n++;
+    double dt = t - st->mean_t;
+    double dy = y - st->mean_y;
+    st->mean_t += dt / st->n;
+    st->mean_y += dy / st->n;
+    st->m2_t += dt * (t - st->mean_t);
+    st->m2_y += dy * (y - st->mean_y);
+    st->c_ty += dt * (y - st->mean_y);
+    if (code < st->min) {
+        st->min = code;
+    }
+    if (code > st->max) {
+        st->max = code;
+    }
+}
+
+void step_stats_merge(struct step_stats *a, const struct step_stats *b){
+    if (b->n == 0) {
+        return;
+    }
+    if (a->n == 0) {
+        int step = a->step;
+        int16_t cmd_val = a->cmd_val;
+        *a = *b;
+        a->step = step;
+        a->cmd_val = cmd_val;
+        return;
+    }
+    double n = a->n + b->n;
+    double dt = b->mean_t - a->mean_t;
+    double dy = b->mean_y - a->mean_y;
+    double w = (double)a->n * b->n / n;
+    a->m2_t += b->m2_t + dt * dt * w;
+    a->m2_y += b->m2_y + dy * dy * w;
+    a->c_ty += b->c_ty + dt * dy * w;
+    a->mean_t += dt * b->n / n;
+    a->mean_y += dy * b->n / n;
+    a->n += b->n;
+    if (b->min < a->min) {
+        a->min = b->min;
+    }
+    if (b->max > a->max) {
+        a->max = b->max;
+    }
+}
+
+double step_stats_slope(const struct step_stats *st){
+    return st->m2_t > 0 ? st->c_ty / st->m2_t : 0;
+}
+
+double step_stats_noise_rms(const struct step_stats *st){
+    if (st->n < 3) {
+        return 0;
+    }
+    double ss_res = st->m2_y;
+    if (st->m2_t > 0) {
+        ss_res -= st->c_ty * st->c_ty / st->m2_t;
+    }
+    if (ss_res < 0) {
+        ss_res = 0; // rounding
+    }
+    return sqrt(ss_res / (st->n - 2)); // two fitted parameters
+}
+
+double step_stats_enob(double noise_rms){
+    // an ideal N bit quantiser has LSB/sqrt(12) rms noise
+    double q = noise_rms * sqrt(12.0);
+    if (q <= 1.0) {
+        return LHR_BITS;
+    }
+    return LHR_BITS - log2(q);
+}
+
+void step_stats_result(const struct step_stats *st, const struct step_stats *prev,
+                       struct step_result *res){
+    res->step = st->step;
+    res->cmd_val = st->cmd_val;
+    res->n = st->n;
+    res->mean = st->mean_y;
+    res->slope = step_stats_slope(st);
+    res->noise_rms = step_stats_noise_rms(st);
+    res->span = (prev != NULL && prev->n > 0) ? fabs(st->mean_y - prev->mean_y) : 0;
+    res->snr_db = (res->span > 0 && res->noise_rms > 0) ? 20 * log10(res->span / res->noise_rms) : 0;
+    res->enob = step_stats_enob(res->noise_rms);
+    res->p1 = res->p50 = res->p99 = 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file step_stats.h
+ * @brief Streaming per-step statistics of LHR codes: mean, linear trend and
+ * the noise left around it, with SNR and ENOB derived from the 24 bit codes.
+ * Constant memory per step; raw samples are never stored.
+ */
+
+#ifndef INC_STEP_STATS_H_
+#define INC_STEP_STATS_H_
+
+#include <stdint.h>
+
+#define LHR_BITS 24
+
+struct step_stats {
+    int step;
+    int16_t cmd_val;
+    unsigned long n;
+    double mean_t;    // s
+    double mean_y;    // codes
+    double m2_t;      // sum of squared deviations of t
+    double m2_y;      // sum of squared deviations of y
+    double c_ty;      // sum of co-deviations of t and y
+    uint32_t min;
+    uint32_t max;
+};
+
+// Derived figures for one finished (or in-progress) step
+struct step_result {
+    int step;
+    int16_t cmd_val;
+    unsigned long n;
+    double mean;      // codes
+    double slope;     // codes/s of the fitted trend
+    double noise_rms; // codes, residual around the trend
+    double span;      // codes, |mean - mean of previous step|, 0 for the first
+    double snr_db;    // 20 log10(span / noise_rms), 0 when span is unknown
+    double enob;      // bits
+    uint32_t p1;      // code quantiles, 0 when no sketch was kept
+    uint32_t p50;
+    uint32_t p99;
+};
+
+void step_stats_init(struct step_stats *st, int step, int16_t cmd_val);
+
+/**
+ * @brief Add one sample
+ * @param t sample time in seconds (relative to any fixed origin)
+ * @param code LHR data code
+ */
+void step_stats_add(struct step_stats *st, double t, uint32_t code);
+
+/**
+ * @brief Combine the accumulators of b into a (parallel/streamed merge)
+ */
+void step_stats_merge(struct step_stats *a, const struct step_stats *b);
+
+/**
+ * @brief RMS of the residual after removing the least-squares line
+ */
+double step_stats_noise_rms(const struct step_stats *st);
+
+double step_stats_slope(const struct step_stats *st);
+
+/**
+ * @brief Effective number of bits implied by a noise level in codes
+ */
+double step_stats_enob(double noise_rms);
+
+/**
+ * @brief Compute the derived figures
+ * @param prev previous step for the span/SNR, or NULL
+ */
+void step_stats_result(const struct step_stats *st, const struct step_stats *prev,
+                       struct step_result *res);
+
+#endif /* INC_STEP_STATS_H_ */
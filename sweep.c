@@ -0,0 +1,78 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sweep.h"
+
+void sweep_plan_default(struct sweep_plan *plan){
+    memset(plan, 0, sizeof(*plan));
+    plan->num_steps = 1;
+    plan->start_cmd = 100;
+    plan->cmd_inc = 1000;
+    plan->max_cmd = 24000;
+    plan->fast_rcount = RCOUNT_FAST_DEFAULT;
+    plan->hires_rcount = RCOUNT_HIRES_DEFAULT;
+    plan->slope_thresh = RCOUNT_SLOPE_DEFAULT;
+    plan->drift_model = DRIFT_LINEAR;
+}
+
+int sweep_init(struct sweep *sw, const struct sweep_plan *plan){
+    memset(sw, 0, sizeof(*sw));
+    sw->plan = *plan;
+    sw->step_cmd = plan->start_cmd;
+    sw->cmd_val = 0; // the sweep proper starts from 0 after the baseline step
+    if (plan->adaptive) {
+        rcount_adapt_init(&sw->adapt, plan->fast_rcount, plan->hires_rcount, plan->slope_thresh);
+    }
+    drift_init(&sw->drift, plan->drift_model);
+    return run_summary_init(&sw->summary, plan->num_steps);
+}
+
+void sweep_step_begin(struct sweep *sw){
+    step_stats_init(&sw->st, sw->step, sw->step_cmd);
+    kll_init(&sw->sketch);
+}
+
+int sweep_sample(struct sweep *sw, double t, uint32_t code){
+    step_stats_add(&sw->st, t, code);
+    kll_update(&sw->sketch, code);
+    return sw->plan.adaptive && rcount_adapt_sample(&sw->adapt, t, code);
+}
+
+double sweep_corrected(const struct sweep *sw, double t, uint32_t code){
+    return code - drift_offset(&sw->drift, t);
+}
+
+int sweep_step_end(struct sweep *sw, int *revisit){
+    run_summary_add_step(&sw->summary, &sw->st, &sw->sketch);
+    sw->steps_done++;
+
+    *revisit = 0;
+    if (sw->plan.drift_every > 0) {
+        if (sw->step == 0) {
+            // the first step sits at the reference command: it is the baseline
+            drift_add_point(&sw->drift, sw->st.mean_t, sw->st.mean_y);
+        } else if (sw->step % sw->plan.drift_every == 0 && sw->step + 1 < sw->plan.num_steps) {
+            *revisit = 1;
+        }
+    }
+
+    sw->cmd_val += sw->plan.cmd_inc;
+    return abs(sw->cmd_val) > sw->plan.max_cmd ? -1 : 0;
+}
+
+int sweep_command_sent(struct sweep *sw){
+    sw->step_cmd = sw->cmd_val;
+    sw->step++;
+    return sw->plan.adaptive && rcount_adapt_command(&sw->adapt);
+}
+
+int sweep_running(const struct sweep *sw){
+    return sw->step < sw->plan.num_steps;
+}
+
+uint16_t sweep_rcount(const struct sweep *sw){
+    return sw->plan.adaptive ? rcount_adapt_rcount(&sw->adapt) : sw->plan.hires_rcount;
+}
+
+void sweep_free(struct sweep *sw){
+    run_summary_free(&sw->summary);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file sweep.h
+ * @brief The command sweep and per-sample processing of a capture, shared by
+ * live acquisition (main) and offline replay (ldc_replay). The caller owns
+ * the I/O: it feeds timestamped codes in and carries out the commands and
+ * RCOUNT changes the sweep asks for, so both paths run the same decisions.
+ */
+
+#ifndef INC_SWEEP_H_
+#define INC_SWEEP_H_
+
+#include <stdint.h>
+#include "drift.h"
+#include "kll.h"
+#include "rcount_adapt.h"
+#include "run_summary.h"
+#include "step_stats.h"
+
+struct sweep_plan {
+    int num_steps;
+    int16_t start_cmd;      // command of the first (baseline) step
+    int16_t cmd_inc;
+    int16_t max_cmd;        // |command| limit, the sweep stops beyond it
+    int adaptive;           // 1 to switch RCOUNT between fast and hires
+    uint16_t fast_rcount;
+    uint16_t hires_rcount;
+    double slope_thresh;    // codes/s
+    int drift_every;        // reference revisit interval in steps, 0 = off
+    enum drift_model drift_model;
+};
+
+struct sweep {
+    struct sweep_plan plan;
+    int step;               // current step
+    int16_t step_cmd;       // command the current step is taken at
+    int16_t cmd_val;        // next command of the plan
+    struct step_stats st;
+    struct kll_sketch sketch;
+    struct run_summary summary;
+    struct rcount_adapt adapt;
+    struct drift_track drift;
+    int steps_done;
+};
+
+/**
+ * @brief Plan with main()'s defaults
+ */
+void sweep_plan_default(struct sweep_plan *plan);
+
+/**
+ * @brief Start a sweep at step 0, taken at plan->start_cmd
+ * @return 0 on success, -1 on allocation failure
+ */
+int sweep_init(struct sweep *sw, const struct sweep_plan *plan);
+
+/**
+ * @brief Reset the per-step accumulators for sw->step
+ */
+void sweep_step_begin(struct sweep *sw);
+
+/**
+ * @brief Process one sample of the current step
+ * @param t sample time in seconds
+ * @param code LHR data code
+ * @return 1 if RCOUNT must change to sweep_rcount(), 0 otherwise
+ */
+int sweep_sample(struct sweep *sw, double t, uint32_t code);
+
+/**
+ * @brief Drift-corrected code, equal to code when drift tracking is off
+ */
+double sweep_corrected(const struct sweep *sw, double t, uint32_t code);
+
+/**
+ * @brief Finish the current step and plan the next command
+ * @param revisit set to 1 when a drift revisit to plan.start_cmd is due now
+ * @return 0 if sw->cmd_val should be sent next, -1 if it exceeds plan.max_cmd
+ */
+int sweep_step_end(struct sweep *sw, int *revisit);
+
+/**
+ * @brief Record that sw->cmd_val was sent, moving on to the next step
+ * @return 1 if RCOUNT must change to sweep_rcount(), 0 otherwise
+ */
+int sweep_command_sent(struct sweep *sw);
+
+/**
+ * @brief 1 while steps of the plan remain
+ */
+int sweep_running(const struct sweep *sw);
+
+uint16_t sweep_rcount(const struct sweep *sw);
+
+void sweep_free(struct sweep *sw);
+
+#endif /* INC_SWEEP_H_ */
@@ -0,0 +1,307 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include "sysmon.h"
+
+#define CPUFREQ_PATH "/sys/devices/system/cpu/cpu%d/cpufreq/%s"
+#define THERMAL_PATH "/sys/class/thermal/thermal_zone%d/temp"
+#define THROTTLED_PATH "/sys/devices/platform/soc/soc:firmware/get_throttled"
+#define EVENT_RING 64
+
+static pthread_t thread;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile int running = 0;
+static struct timespec origin;
+
+static int num_cpus = 0;
+static int num_zones = 0;
+static char saved_governor[SYSMON_MAX_CPUS][32];
+
+// latest state, under lock
+static unsigned cur_freq[SYSMON_MAX_CPUS];
+static double cur_temp_c = 0;
+static int cur_throttled = 0;
+static double last_freq_change = -1e9;
+static double last_throttle_change = -1e9;
+static struct sysmon_stats stats;
+
+static struct sysmon_event ring[EVENT_RING];
+static unsigned ring_head = 0, ring_tail = 0;
+
+// jitter tracking, sampling thread only
+static double prev_sample = -1;
+static double typical = 0;
+static int intervals = 0;
+
+static double now_s(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (t.tv_sec - origin.tv_sec) + (t.tv_nsec - origin.tv_nsec) * 1e-9;
+}
+
+static int read_text(const char *path, char *buf, size_t len){
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    int ok = fgets(buf, len, f) != NULL;
+    fclose(f);
+    if (!ok) {
+        return -1;
+    }
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+static long read_long(const char *path, int base){
+    char buf[32];
+    return read_text(path, buf, sizeof(buf)) == -1 ? -1 : strtol(buf, NULL, base);
+}
+
+static int write_text(const char *path, const char *text){
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    int ok = fputs(text, f) >= 0;
+    return fclose(f) == 0 && ok ? 0 : -1;
+}
+
+/**
+ * @brief Queue an event, called with lock held; the oldest is dropped when full
+ */
+static void push_event(double t, const char *text){
+    struct sysmon_event *ev = &ring[ring_head % EVENT_RING];
+    ev->t = t;
+    strncpy(ev->text, text, sizeof(ev->text) - 1);
+    ev->text[sizeof(ev->text) - 1] = '\0';
+    ring_head++;
+    if (ring_head - ring_tail > EVENT_RING) {
+        ring_tail = ring_head - EVENT_RING;
+    }
+    syslog(LOG_INFO, "sysmon: %s", text);
+}
+
+static void poll_once(void){
+    char path[96];
+    char text[96];
+    unsigned freq[SYSMON_MAX_CPUS];
+    double temp = 0;
+
+    for (int c = 0; c < num_cpus; c++) {
+        snprintf(path, sizeof(path), CPUFREQ_PATH, c, "scaling_cur_freq");
+        long f = read_long(path, 10);
+        freq[c] = f > 0 ? f : 0;
+    }
+    for (int z = 0; z < num_zones; z++) {
+        snprintf(path, sizeof(path), THERMAL_PATH, z);
+        long milli = read_long(path, 10);
+        if (milli / 1000.0 > temp) {
+            temp = milli / 1000.0;
+        }
+    }
+    long throttled = read_long(THROTTLED_PATH, 16);
+    double t = now_s();
+
+    pthread_mutex_lock(&lock);
+    stats.polls++;
+    for (int c = 0; c < num_cpus; c++) {
+        if (freq[c] == 0) {
+            continue;
+        }
+        if (stats.polls > 1 && freq[c] != cur_freq[c]) {
+            stats.freq_changes++;
+            last_freq_change = t;
+            snprintf(text, sizeof(text), "cpu%d freq %u -> %u kHz", c, cur_freq[c], freq[c]);
+            push_event(t, text);
+        }
+        cur_freq[c] = freq[c];
+        if (stats.freq_min_khz == 0 || freq[c] < stats.freq_min_khz) {
+            stats.freq_min_khz = freq[c];
+        }
+        if (freq[c] > stats.freq_max_khz) {
+            stats.freq_max_khz = freq[c];
+        }
+    }
+    if (num_zones > 0) {
+        if (temp >= SYSMON_HOT_C && cur_temp_c < SYSMON_HOT_C) {
+            snprintf(text, sizeof(text), "temperature %.1f C", temp);
+            push_event(t, text);
+        }
+        cur_temp_c = temp;
+        if (temp > stats.temp_max_c) {
+            stats.temp_max_c = temp;
+        }
+    }
+    if (throttled >= 0) {
+        if (stats.polls > 1 && (throttled & 0xF) != (cur_throttled & 0xF)) {
+            stats.throttle_changes++;
+            last_throttle_change = t;
+            snprintf(text, sizeof(text), "throttle state 0x%lx", throttled);
+            push_event(t, text);
+        }
+        cur_throttled = throttled;
+        stats.throttle_seen |= throttled;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void *monitor(void *arg){
+    (void)arg;
+    struct timespec period = {0, SYSMON_PERIOD_MS * 1000000L};
+    while (running) {
+        poll_once();
+        nanosleep(&period, NULL);
+    }
+    return NULL;
+}
+
+static void pin_governors(void){
+    char path[96];
+    for (int c = 0; c < num_cpus; c++) {
+        snprintf(path, sizeof(path), CPUFREQ_PATH, c, "scaling_governor");
+        if (read_text(path, saved_governor[c], sizeof(saved_governor[c])) == -1) {
+            continue;
+        }
+        if (write_text(path, "performance") == -1) {
+            syslog(LOG_WARNING, "sysmon: cannot set cpu%d governor: %s", c, strerror(errno));
+            saved_governor[c][0] = '\0';
+            continue;
+        }
+        stats.governor_pinned = 1;
+    }
+    if (stats.governor_pinned) {
+        syslog(LOG_INFO, "sysmon: governor pinned to performance");
+    }
+}
+
+static void restore_governors(void){
+    char path[96];
+    for (int c = 0; c < num_cpus; c++) {
+        if (saved_governor[c][0] == '\0') {
+            continue;
+        }
+        snprintf(path, sizeof(path), CPUFREQ_PATH, c, "scaling_governor");
+        if (write_text(path, saved_governor[c]) == -1) {
+            syslog(LOG_WARNING, "sysmon: cannot restore cpu%d governor %s", c, saved_governor[c]);
+        }
+        saved_governor[c][0] = '\0';
+    }
+}
+
+int sysmon_start(struct timespec t0, int pin_governor){
+    char path[96];
+    origin = t0;
+    memset(&stats, 0, sizeof(stats));
+    memset(saved_governor, 0, sizeof(saved_governor));
+    ring_head = ring_tail = 0;
+    sysmon_rate_reset();
+
+    for (num_cpus = 0; num_cpus < SYSMON_MAX_CPUS; num_cpus++) {
+        snprintf(path, sizeof(path), CPUFREQ_PATH, num_cpus, "scaling_cur_freq");
+        if (read_long(path, 10) < 0) {
+            break;
+        }
+    }
+    for (num_zones = 0; num_zones < SYSMON_MAX_ZONES; num_zones++) {
+        snprintf(path, sizeof(path), THERMAL_PATH, num_zones);
+        if (read_long(path, 10) < 0) {
+            break;
+        }
+    }
+    syslog(LOG_INFO, "sysmon: %d cpufreq cores, %d thermal zones, throttle state %s", num_cpus, num_zones,
+           read_long(THROTTLED_PATH, 16) < 0 ? "unavailable" : "available");
+    if (pin_governor) {
+        pin_governors();
+        atexit(restore_governors); // also on the error exits of main()
+    }
+
+    poll_once(); // initial state, so changes are relative to the start of the run
+    running = 1;
+    if (pthread_create(&thread, NULL, monitor, NULL) != 0) {
+        running = 0;
+        restore_governors();
+        syslog(LOG_ERR, "sysmon: cannot start thread");
+        return -1;
+    }
+    return 0;
+}
+
+int sysmon_next_event(struct sysmon_event *ev){
+    int got = 0;
+    pthread_mutex_lock(&lock);
+    if (ring_tail != ring_head) {
+        *ev = ring[ring_tail % EVENT_RING];
+        ring_tail++;
+        got = 1;
+    }
+    pthread_mutex_unlock(&lock);
+    return got;
+}
+
+void sysmon_sample_reset(void){
+    prev_sample = -1;
+}
+
+void sysmon_rate_reset(void){
+    prev_sample = -1;
+    intervals = 0;
+    typical = 0;
+}
+
+const char *sysmon_sample(double t){
+    const char *cause = NULL;
+    double dt = prev_sample >= 0 ? t - prev_sample : 0;
+    prev_sample = t;
+    if (dt <= 0) {
+        return NULL;
+    }
+    if (intervals < SYSMON_WARMUP || dt < SYSMON_SPIKE_FACTOR * typical) {
+        // the typical interval follows slow changes but not the spikes;
+        // RCOUNT changes restart it through sysmon_rate_reset()
+        intervals++;
+        typical += (dt - typical) / (intervals < SYSMON_WARMUP ? intervals : SYSMON_WARMUP);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&lock);
+    stats.spikes++;
+    if (dt > stats.worst_spike_s) {
+        stats.worst_spike_s = dt;
+    }
+    unsigned max_freq = stats.freq_max_khz;
+    int below_max = 0;
+    for (int c = 0; c < num_cpus; c++) {
+        below_max |= cur_freq[c] > 0 && cur_freq[c] < max_freq;
+    }
+    if ((cur_throttled & (SYSMON_FREQ_CAPPED | SYSMON_THROTTLED | SYSMON_SOFT_TEMP)) ||
+        t - last_throttle_change < SYSMON_WINDOW_S) {
+        stats.spikes_throttled++;
+        cause = "throttled";
+    } else if (t - last_freq_change < SYSMON_WINDOW_S || below_max) {
+        stats.spikes_freq++;
+        cause = "cpufreq";
+    } else if (cur_temp_c >= SYSMON_HOT_C) {
+        stats.spikes_hot++;
+        cause = "hot";
+    } else {
+        stats.spikes_unexplained++;
+        cause = "unexplained";
+    }
+    pthread_mutex_unlock(&lock);
+    return cause;
+}
+
+void sysmon_stop(struct sysmon_stats *out){
+    if (running) {
+        running = 0;
+        pthread_join(thread, NULL);
+    }
+    restore_governors();
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
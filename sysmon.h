@@ -0,0 +1,91 @@
+/**
+ * @file sysmon.h
+ * @brief System monitor for captures: samples cpufreq, thermal zones and the
+ * Raspberry Pi throttle state from sysfs on a low-rate thread, and attributes
+ * sampling jitter spikes (late or missed conversions) to what the system was
+ * doing at the time. Can pin the cpufreq governor to "performance" for the
+ * duration of a run.
+ * @note One monitor per process. The sampling thread drains the monitor's
+ * events with sysmon_next_event() so only it writes the data log.
+ */
+
+#ifndef INC_SYSMON_H_
+#define INC_SYSMON_H_
+
+#include <time.h>
+
+#define SYSMON_PERIOD_MS 100      // sysfs polling period
+#define SYSMON_MAX_CPUS 8
+#define SYSMON_MAX_ZONES 8
+#define SYSMON_HOT_C 80.0         // Pi firmware starts soft throttling here
+#define SYSMON_WINDOW_S 1.0       // a spike this close to a change is blamed on it
+#define SYSMON_SPIKE_FACTOR 2.0   // interval over this x typical is a spike
+#define SYSMON_WARMUP 20          // intervals before spikes are detected
+
+// get_throttled bits, current state in the low bits
+#define SYSMON_UNDERVOLT 0x1
+#define SYSMON_FREQ_CAPPED 0x2
+#define SYSMON_THROTTLED 0x4
+#define SYSMON_SOFT_TEMP 0x8
+
+struct sysmon_stats {
+    unsigned long polls;
+    double temp_max_c;
+    unsigned freq_min_khz;    // lowest cur_freq seen on any core
+    unsigned freq_max_khz;
+    unsigned freq_changes;
+    unsigned throttle_changes;
+    unsigned throttle_seen;   // OR of all get_throttled values
+    int governor_pinned;      // 1 if the governor was set to performance
+    unsigned long spikes;     // sampling intervals over SYSMON_SPIKE_FACTOR x typical
+    unsigned long spikes_throttled;
+    unsigned long spikes_freq;
+    unsigned long spikes_hot;
+    unsigned long spikes_unexplained;
+    double worst_spike_s;
+};
+
+struct sysmon_event {
+    double t;                 // s since the monitor's t0
+    char text[96];
+};
+
+/**
+ * @brief Start the monitor thread
+ * @param t0 CLOCK_MONOTONIC origin of the event times (main's start time)
+ * @param pin_governor 1 to switch every core to the performance governor
+ * @return 0 on success, -1 on failure
+ */
+int sysmon_start(struct timespec t0, int pin_governor);
+
+/**
+ * @brief Take the oldest pending event
+ * @return 1 if ev was filled, 0 if there is none
+ */
+int sysmon_next_event(struct sysmon_event *ev);
+
+/**
+ * @brief Feed the time of a conversion read
+ * @param t s since t0
+ * @return cause of a jitter spike ("throttled", "cpufreq", "hot",
+ * "unexplained"), NULL if the interval was normal
+ */
+const char *sysmon_sample(double t);
+
+/**
+ * @brief Forget the previous sample after a deliberate gap (a command)
+ */
+void sysmon_sample_reset(void);
+
+/**
+ * @brief Forget the typical interval too, when the conversion time changes
+ * (RCOUNT change): it is learnt again over SYSMON_WARMUP intervals
+ */
+void sysmon_rate_reset(void);
+
+/**
+ * @brief Stop the thread, restore the governors and return the run's figures
+ */
+void sysmon_stop(struct sysmon_stats *out);
+
+#endif /* INC_SYSMON_H_ */
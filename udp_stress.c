@@ -0,0 +1,397 @@
+/**
+ * @file udp_stress.c
+ * @brief Command throughput stress test of the actuator link. Sends CMD_DATA
+ * frames at increasing rates through the batched UDP_group path and measures
+ * loss, reordering and echo round-trip latency until the receiver saturates.
+ * @note The receiver must echo each datagram back verbatim, as mock_actuator
+ * does. Each frame is a normal CMD_DATA holding one command value on every
+ * channel, followed by a 16 byte trailer (magic, sequence, send time).
+ */
+
+#define _GNU_SOURCE // recvmmsg(), pthread_setaffinity_np()
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "UDP_group.h"
+
+#define STRESS_MAGIC 0x4B535452u // "KSTR"
+#define STRESS_FRAME_SIZE (CMD_SIZE + 16)
+#define LAT_BUCKETS 100000 // 1 us buckets up to 100 ms, plus one overflow
+#define RX_BATCH 32
+#define MAX_LEVELS 64
+
+struct stress_level {
+    double target_rate;     // frames/s requested
+    double send_rate;       // frames/s actually sent
+    double echo_rate;       // frames/s echoed back
+    unsigned long sent;
+    unsigned long received; // unique sequence numbers echoed
+    unsigned long duplicates;
+    unsigned long reordered; // echoes older than the newest seen
+    unsigned long send_errors;
+    double loss_pct;
+    double lat_p50_us;
+    double lat_p99_us;
+    double lat_p999_us;
+    double lat_max_us;
+    int saturated;
+};
+
+// receiver state for the level in progress
+static atomic_int rx_running;
+static int rx_fd = -1;
+static uint32_t rx_base_seq = 0;
+static uint32_t rx_count = 0;  // sequence numbers in this level
+static unsigned char *rx_seen = NULL; // one bit per sequence number
+static uint32_t rx_highest = 0;
+static int rx_any = 0;
+static uint32_t *lat_hist = NULL;
+static double lat_max_us = 0;
+static atomic_ulong rx_received, rx_duplicates, rx_reordered; // receiver counts, read after the join
+static int sender_cpu = -1; // CPU the sender is pinned to, kept free of the receiver
+
+static uint64_t now_ns(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+static void put_trailer(unsigned char *frame, uint32_t seq, uint64_t tx_ns){
+    uint32_t words[4] = {
+        htonl(STRESS_MAGIC), htonl(seq),
+        htonl((uint32_t)(tx_ns >> 32)), htonl((uint32_t)tx_ns)
+    };
+    memcpy(frame + CMD_SIZE, words, sizeof(words));
+}
+
+static int get_trailer(const unsigned char *frame, size_t len, uint32_t *seq, uint64_t *tx_ns){
+    uint32_t words[4];
+    if (len != STRESS_FRAME_SIZE) {
+        return -1;
+    }
+    memcpy(words, frame + CMD_SIZE, sizeof(words));
+    if (ntohl(words[0]) != STRESS_MAGIC) {
+        return -1;
+    }
+    *seq = ntohl(words[1]);
+    *tx_ns = ((uint64_t)ntohl(words[2]) << 32) | ntohl(words[3]);
+    return 0;
+}
+
+static void record_echo(uint32_t seq, uint64_t tx_ns, uint64_t rx_ns){
+    uint32_t idx = seq - rx_base_seq;
+    if (idx >= rx_count) {
+        return; // late echo from an earlier level
+    }
+    if (rx_seen[idx / 8] & (1u << (idx % 8))) {
+        atomic_fetch_add(&rx_duplicates, 1);
+        return;
+    }
+    rx_seen[idx / 8] |= 1u << (idx % 8);
+    atomic_fetch_add(&rx_received, 1);
+
+    if (rx_any && (int32_t)(seq - rx_highest) < 0) {
+        atomic_fetch_add(&rx_reordered, 1);
+    } else {
+        rx_highest = seq;
+        rx_any = 1;
+    }
+
+    double lat_us = (rx_ns - tx_ns) / 1000.0;
+    uint32_t bucket = lat_us < LAT_BUCKETS ? (uint32_t)lat_us : LAT_BUCKETS;
+    lat_hist[bucket]++;
+    if (lat_us > lat_max_us) {
+        lat_max_us = lat_us;
+    }
+}
+
+static void *receiver(void *arg){
+    static unsigned char bufs[RX_BATCH][BUF_SIZE];
+    struct mmsghdr msgs[RX_BATCH];
+    struct iovec iov[RX_BATCH];
+    (void)arg;
+
+    if (sender_cpu >= 0) { // the thread inherited the sender's pinning; move off its CPU
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int c = 0; c < CPU_SETSIZE && c < sysconf(_SC_NPROCESSORS_ONLN); c++) {
+            CPU_SET(c, &set);
+        }
+        if (CPU_COUNT(&set) > 1) {
+            CPU_CLR(sender_cpu, &set);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    for (int i = 0; i < RX_BATCH; i++) {
+        iov[i].iov_base = bufs[i];
+        iov[i].iov_len = BUF_SIZE;
+        memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    struct pollfd pfd = {rx_fd, POLLIN, 0};
+    while (atomic_load(&rx_running)) {
+        if (poll(&pfd, 1, 50) <= 0) {
+            continue;
+        }
+        int n = recvmmsg(rx_fd, msgs, RX_BATCH, MSG_DONTWAIT, NULL);
+        uint64_t rx_ns = now_ns();
+        for (int i = 0; i < n; i++) {
+            uint32_t seq;
+            uint64_t tx_ns;
+            if (get_trailer(bufs[i], msgs[i].msg_len, &seq, &tx_ns) == 0) {
+                record_echo(seq, tx_ns, rx_ns);
+            }
+        }
+    }
+    return NULL;
+}
+
+static double hist_percentile(double p, unsigned long total){
+    unsigned long rank = (unsigned long)(p * total);
+    unsigned long cum = 0;
+    for (int b = 0; b <= LAT_BUCKETS; b++) {
+        cum += lat_hist[b];
+        if (cum > rank) {
+            return b + 0.5;
+        }
+    }
+    return LAT_BUCKETS;
+}
+
+/**
+ * @brief Run one rate level: send for duration_s, then wait for stragglers.
+ */
+static void run_level(struct stress_level *lv, uint32_t *seq, double duration_s,
+                      unsigned int batch, int16_t cmd_val){
+    static unsigned char frames[UDP_GROUP_MAX_BATCH][STRESS_FRAME_SIZE];
+    int targets = UDP_group_num_targets();
+    uint32_t planned = (uint32_t)(lv->target_rate * duration_s) + batch;
+
+    for (unsigned int k = 0; k < batch; k++) {
+        for (int i = 0; i < CMD_SIZE/2; i++) {
+            int16_t v = htons(cmd_val);
+            memcpy(frames[k] + 2*i, &v, sizeof(v));
+        }
+    }
+
+    rx_base_seq = *seq;
+    rx_count = planned;
+    rx_seen = calloc(planned / 8 + 1, 1);
+    memset(lat_hist, 0, (LAT_BUCKETS + 1) * sizeof(*lat_hist));
+    lat_max_us = 0;
+    atomic_store(&rx_received, 0);
+    atomic_store(&rx_duplicates, 0);
+    atomic_store(&rx_reordered, 0);
+    rx_any = 0;
+    atomic_store(&rx_running, 1);
+
+    pthread_t rx_thread;
+    pthread_create(&rx_thread, NULL, receiver, NULL);
+
+    uint64_t period_ns = (uint64_t)(batch * 1e9 / lv->target_rate);
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)(duration_s * 1e9);
+    uint64_t next = start;
+    lv->sent = 0;
+    lv->send_errors = 0;
+
+    while (next < end && lv->sent + batch <= planned) {
+        struct timespec wake = {(time_t)(next / 1000000000u), (long)(next % 1000000000u)};
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+
+        uint64_t tx = now_ns();
+        for (unsigned int k = 0; k < batch; k++) {
+            put_trailer(frames[k], *seq + k, tx);
+        }
+        int sent = UDP_group_send_raw(&frames[0][0], STRESS_FRAME_SIZE, batch);
+        if (sent < (int)batch * targets) {
+            lv->send_errors += batch * targets - (sent > 0 ? sent : 0);
+        }
+        *seq += batch;
+        lv->sent += batch;
+        next += period_ns;
+    }
+    double elapsed = (now_ns() - start) * 1e-9;
+
+    usleep(200000); // drain echoes still in flight
+    atomic_store(&rx_running, 0);
+    pthread_join(rx_thread, NULL);
+
+    unsigned long expected = lv->sent;
+    lv->received = atomic_load(&rx_received);
+    lv->duplicates = atomic_load(&rx_duplicates);
+    lv->reordered = atomic_load(&rx_reordered);
+    lv->send_rate = lv->sent / elapsed;
+    lv->echo_rate = lv->received / elapsed;
+    lv->loss_pct = expected ? 100.0 * (expected - lv->received) / expected : 0;
+    lv->lat_p50_us = lv->received ? hist_percentile(0.50, lv->received) : 0;
+    lv->lat_p99_us = lv->received ? hist_percentile(0.99, lv->received) : 0;
+    lv->lat_p999_us = lv->received ? hist_percentile(0.999, lv->received) : 0;
+    lv->lat_max_us = lat_max_us;
+    free(rx_seen);
+    rx_seen = NULL;
+}
+
+static void write_report(FILE *f, struct stress_level *levels, int num_levels,
+                         int sat_level, char *target, char *tuning){
+    int ok = sat_level < 0 ? num_levels - 1 : sat_level - 1;
+    fprintf(f, "{\n");
+    fprintf(f, "  \"target\": \"%s\",\n", target);
+    fprintf(f, "  \"tuning\": \"%s\",\n", tuning != NULL ? tuning : "none");
+    fprintf(f, "  \"saturated\": %d,\n", sat_level >= 0);
+    fprintf(f, "  \"saturation_rate\": %.1f,\n", sat_level >= 0 ? levels[sat_level].target_rate : 0.0);
+    fprintf(f, "  \"max_ok_rate\": %.1f,\n", ok >= 0 ? levels[ok].echo_rate : 0.0);
+    fprintf(f, "  \"p99_latency_us\": %.1f,\n", ok >= 0 ? levels[ok].lat_p99_us : 0.0);
+    fprintf(f, "  \"p999_latency_us\": %.1f,\n", ok >= 0 ? levels[ok].lat_p999_us : 0.0);
+    fprintf(f, "  \"levels\": [\n");
+    for (int i = 0; i < num_levels; i++) {
+        struct stress_level *lv = &levels[i];
+        fprintf(f, "    {\"target_rate\": %.1f, \"send_rate\": %.1f, \"echo_rate\": %.1f, "
+                "\"sent\": %lu, \"received\": %lu, \"duplicates\": %lu, \"reordered\": %lu, "
+                "\"send_errors\": %lu, \"loss_pct\": %.3f, \"p50_us\": %.1f, \"p99_us\": %.1f, "
+                "\"p999_us\": %.1f, \"max_us\": %.1f, \"saturated\": %d}%s\n",
+                lv->target_rate, lv->send_rate, lv->echo_rate, lv->sent, lv->received,
+                lv->duplicates, lv->reordered, lv->send_errors, lv->loss_pct, lv->lat_p50_us,
+                lv->lat_p99_us, lv->lat_p999_us, lv->lat_max_us, lv->saturated,
+                i + 1 < num_levels ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+int main(int argc, char *argv[]){
+    int opt = 0;
+    char target[64] = "127.0.0.1:2345";
+    double start_rate = 100;     // frames/s
+    double max_rate = 200000;
+    double factor = 2;
+    double duration_s = 2;
+    unsigned int batch = 8;
+    double loss_limit = 1.0;     // percent
+    int16_t cmd_val = 100;       // command held on every channel
+    char *report = NULL;
+    char *tuning_spec = NULL;
+    struct UDP_tuning tuning;
+
+    while ((opt = getopt(argc, argv, "ht:r:R:f:d:b:x:c:o:L:")) != -1) {
+        switch(opt) {
+            case 't':
+                strncpy(target, optarg, sizeof(target) - 1);
+                break;
+            case 'r':
+                start_rate = atof(optarg);
+                break;
+            case 'R':
+                max_rate = atof(optarg);
+                break;
+            case 'f':
+                factor = atof(optarg);
+                break;
+            case 'd':
+                duration_s = atof(optarg);
+                break;
+            case 'b':
+                batch = atoi(optarg);
+                break;
+            case 'x':
+                loss_limit = atof(optarg);
+                break;
+            case 'c':
+                cmd_val = atoi(optarg);
+                break;
+            case 'o':
+                report = optarg;
+                break;
+            case 'L':
+                tuning_spec = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-t host:port] [-r start rate] [-R max rate] [-f rate factor] "
+                        "[-d seconds per level] [-b batch] [-x loss %%] [-c command] [-o report.json] "
+                        "[-L socket tuning]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (start_rate <= 0 || factor <= 1 || duration_s <= 0 || batch == 0 || batch > UDP_GROUP_MAX_BATCH) {
+        fprintf(stderr, "Invalid rate, factor, duration or batch (1..%d)\n", UDP_GROUP_MAX_BATCH);
+        exit(EXIT_FAILURE);
+    }
+
+    UDP_group_init(1);
+    if (UDP_group_add_spec(target) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    rx_fd = UDP_group_fd(AF_INET) >= 0 ? UDP_group_fd(AF_INET) : UDP_group_fd(AF_INET6);
+
+    // compare RTT tails with and without each option of the profile
+    if (UDP_tuning_parse(&tuning, tuning_spec) == -1) {
+        exit(EXIT_FAILURE);
+    }
+    openlog(NULL, LOG_PERROR, LOG_LOCAL6);
+    UDP_apply_tuning(rx_fd, &tuning);
+    if (UDP_pin_thread(&tuning) == 0) {
+        sender_cpu = tuning.cpu;
+    }
+    lat_hist = calloc(LAT_BUCKETS + 1, sizeof(*lat_hist));
+
+    struct stress_level levels[MAX_LEVELS];
+    int num_levels = 0;
+    int sat_level = -1;
+    uint32_t seq = 0;
+
+    printf("%10s %10s %10s %8s %8s %8s %9s %9s %9s\n", "target/s", "sent/s", "echo/s",
+           "loss%", "reorder", "dup", "p50 us", "p99 us", "max us");
+    for (double rate = start_rate; rate <= max_rate && num_levels < MAX_LEVELS; rate *= factor) {
+        struct stress_level *lv = &levels[num_levels++];
+        memset(lv, 0, sizeof(*lv));
+        lv->target_rate = rate;
+        run_level(lv, &seq, duration_s, batch, cmd_val);
+
+        // saturated when the receiver loses frames, or we cannot offer the rate
+        lv->saturated = lv->loss_pct > loss_limit || lv->send_rate < 0.95 * rate;
+        printf("%10.0f %10.0f %10.0f %8.3f %8lu %8lu %9.1f %9.1f %9.1f%s\n", lv->target_rate,
+               lv->send_rate, lv->echo_rate, lv->loss_pct, lv->reordered, lv->duplicates,
+               lv->lat_p50_us, lv->lat_p99_us, lv->lat_max_us,
+               lv->saturated ? (lv->send_rate < 0.95 * rate ? "  sender limited" : "  saturated") : "");
+        if (lv->saturated) {
+            sat_level = num_levels - 1;
+            break;
+        }
+    }
+
+    if (sat_level == 0 && levels[0].received == 0) {
+        printf("No echoes received: is the receiver echoing datagrams?\n");
+    } else if (sat_level > 0) {
+        printf("Saturation at %.0f frames/s; highest clean rate %.0f frames/s\n",
+               levels[sat_level].target_rate, levels[sat_level - 1].echo_rate);
+    } else if (sat_level < 0) {
+        printf("No saturation up to %.0f frames/s\n", levels[num_levels - 1].target_rate);
+    }
+
+    if (report != NULL) {
+        FILE *f = fopen(report, "w");
+        if (f == NULL) {
+            fprintf(stderr, "Failed to open report %s: %s\n", report, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        write_report(f, levels, num_levels, sat_level, target, tuning_spec);
+        fclose(f);
+    }
+
+    UDP_group_close();
+    free(lat_hist);
+    return 0;
+}